@@ -0,0 +1,94 @@
+// Copyright 2026 gRPC authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "backend_list.h"
+
+#include <arpa/inet.h>
+
+#include <iostream>
+
+#include "absl/strings/match.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/string_view.h"
+
+// Returns true if the address is an IP address followed by a port.
+static bool IsIpAddressWithPort(absl::string_view address) {
+  size_t colon = address.rfind(':');
+  if (colon == absl::string_view::npos) {
+    return false;
+  }
+  absl::string_view ip = address.substr(0, colon);
+  int port;
+  if (!absl::SimpleAtoi(address.substr(colon + 1), &port) || port <= 0 ||
+      port > 65535) {
+    return false;
+  }
+  std::string ip_string;
+  unsigned char buf[sizeof(struct in6_addr)];
+  if (absl::StartsWith(ip, "[") && absl::EndsWith(ip, "]")) {
+    ip_string = std::string(ip.substr(1, ip.size() - 2));
+    return inet_pton(AF_INET6, ip_string.c_str(), buf) == 1;
+  }
+  ip_string = std::string(ip);
+  return inet_pton(AF_INET, ip_string.c_str(), buf) == 1;
+}
+
+absl::optional<std::vector<Backend>> ParseBackends(const std::string& text) {
+  std::vector<Backend> backends;
+  for (absl::string_view item : absl::StrSplit(text, ',', absl::SkipEmpty())) {
+    Backend backend;
+    std::pair<absl::string_view, absl::string_view> address_weight =
+        absl::StrSplit(item, absl::MaxSplits('=', 1));
+    backend.address = std::string(address_weight.first);
+    if (!IsIpAddressWithPort(backend.address)) {
+      std::cerr << "Invalid backend address: " << backend.address
+                << std::endl;
+      return {};
+    }
+    if (!address_weight.second.empty() &&
+        (!absl::SimpleAtoi(address_weight.second, &backend.weight) ||
+         backend.weight <= 0)) {
+      std::cerr << "Invalid backend weight: " << item << std::endl;
+      return {};
+    }
+    backends.push_back(std::move(backend));
+  }
+  return backends;
+}
+
+std::string GetBackendTarget(const Backend& backend) {
+  bool ipv6 = absl::StartsWith(backend.address, "[");
+  return (ipv6 ? "ipv6:" : "ipv4:") + backend.address;
+}
+
+BackendPicker::BackendPicker(std::vector<Backend> backends)
+    : backends_(std::move(backends)), current_(backends_.size()) {}
+
+const Backend& BackendPicker::Next() {
+  // Smooth weighted round robin spreads picks of heavy backends over the
+  // round instead of picking them in a row.
+  absl::MutexLock l(&lock_);
+  int64_t total = 0;
+  size_t best = 0;
+  for (size_t i = 0; i < backends_.size(); i++) {
+    current_[i] += backends_[i].weight;
+    total += backends_[i].weight;
+    if (current_[i] > current_[best]) {
+      best = i;
+    }
+  }
+  current_[best] -= total;
+  return backends_[best];
+}
@@ -0,0 +1,57 @@
+// Copyright 2026 gRPC authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef GCS_BENCHMARK_BACKEND_LIST_H_
+#define GCS_BENCHMARK_BACKEND_LIST_H_
+
+#include <string>
+#include <vector>
+
+#include "absl/synchronization/mutex.h"
+#include "absl/types/optional.h"
+
+// Backend address which channels connect to without name resolution.
+struct Backend {
+  // IPv4 address with port (1.2.3.4:443) or IPv6 one ([::1]:443)
+  std::string address;
+  // Share of channels assigned to this backend relative to others
+  int weight = 1;
+};
+
+// Parses a comma-separated list of backends, each of which may have a
+// weight after "=", for example "127.0.0.1:50051=3,[::1]:50052". Returns
+// nothing if an address is not an IP address with a port.
+absl::optional<std::vector<Backend>> ParseBackends(const std::string& text);
+
+// Returns the target of the static resolver of gRPC for the backend
+// (ipv4:1.2.3.4:443 or ipv6:[::1]:443).
+std::string GetBackendTarget(const Backend& backend);
+
+// Assigns backends to new channels in proportion to their weights. Equal
+// weights make it round robin.
+class BackendPicker {
+ public:
+  explicit BackendPicker(std::vector<Backend> backends);
+
+  // Returns the backend for the next channel.
+  const Backend& Next();
+
+ private:
+  std::vector<Backend> backends_;
+  absl::Mutex lock_;
+  // Current weights of the smooth weighted round robin
+  std::vector<int64_t> current_ ABSL_GUARDED_BY(lock_);
+};
+
+#endif  // GCS_BENCHMARK_BACKEND_LIST_H_
@@ -0,0 +1,104 @@
+// Copyright 2026 gRPC authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "channel_args_profile.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+#include "absl/strings/ascii.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/string_view.h"
+#include "absl/strings/strip.h"
+
+// Returns true if the value looks like an integer, whether or not it fits.
+static bool IsInteger(absl::string_view value) {
+  if (!absl::ConsumePrefix(&value, "-")) {
+    absl::ConsumePrefix(&value, "+");
+  }
+  return !value.empty() && std::all_of(value.begin(), value.end(),
+                                       absl::ascii_isdigit);
+}
+
+absl::optional<std::vector<ChannelArgsProfile>> LoadChannelArgsProfiles(
+    const std::string& path) {
+  std::ifstream file(path);
+  if (!file.is_open()) {
+    std::cerr << "Failed to open " << path << std::endl;
+    return {};
+  }
+  std::vector<ChannelArgsProfile> profiles;
+  std::string line;
+  int line_number = 0;
+  while (std::getline(file, line)) {
+    line_number += 1;
+    absl::string_view text = absl::StripAsciiWhitespace(line);
+    if (text.empty() || text[0] == '#') {
+      continue;
+    }
+    if (text.front() == '[' && text.back() == ']') {
+      text = absl::StripAsciiWhitespace(text.substr(1, text.size() - 2));
+      if (text.empty()) {
+        std::cerr << path << ":" << line_number << ": Empty profile name"
+                  << std::endl;
+        return {};
+      }
+      profiles.push_back(ChannelArgsProfile{std::string(text), {}});
+      continue;
+    }
+    size_t eq = text.find('=');
+    if (eq == absl::string_view::npos || profiles.empty()) {
+      std::cerr << path << ":" << line_number
+                << ": Expected [name] or key = value" << std::endl;
+      return {};
+    }
+    absl::string_view value = absl::StripAsciiWhitespace(text.substr(eq + 1));
+    int int_value;
+    if (IsInteger(value) && !absl::SimpleAtoi(value, &int_value)) {
+      std::cerr << path << ":" << line_number << ": Value out of int range: "
+                << value << std::endl;
+      return {};
+    }
+    profiles.back().args.emplace_back(
+        std::string(absl::StripAsciiWhitespace(text.substr(0, eq))),
+        std::string(value));
+  }
+  return profiles;
+}
+
+absl::optional<ChannelArgsProfile> FindChannelArgsProfile(
+    const std::vector<ChannelArgsProfile>& profiles, const std::string& name) {
+  for (const auto& profile : profiles) {
+    if (profile.name == name) {
+      return profile;
+    }
+  }
+  if (name == "default") {
+    return ChannelArgsProfile{name, {}};
+  }
+  return {};
+}
+
+void ApplyChannelArgsProfile(const ChannelArgsProfile& profile,
+                             grpc::ChannelArguments* channel_args) {
+  for (const auto& arg : profile.args) {
+    int value;
+    if (absl::SimpleAtoi(arg.second, &value)) {
+      channel_args->SetInt(arg.first, value);
+    } else {
+      channel_args->SetString(arg.first, arg.second);
+    }
+  }
+}
@@ -0,0 +1,55 @@
+// Copyright 2026 gRPC authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef GCS_BENCHMARK_CHANNEL_ARGS_PROFILE_H_
+#define GCS_BENCHMARK_CHANNEL_ARGS_PROFILE_H_
+
+#include <grpcpp/support/channel_arguments.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/types/optional.h"
+
+// Named set of channel arguments such as HTTP/2 flow control settings. An
+// unnamed profile has no argument and leaves channels as they are.
+struct ChannelArgsProfile {
+  std::string name;
+  std::vector<std::pair<std::string, std::string>> args;
+};
+
+// Loads profiles from a file listing arguments under the name of each
+// profile, for example
+//
+//   # Large windows without BDP probing
+//   [bigwindow]
+//   grpc.http2.lookahead_bytes = 16777216
+//   grpc.http2.bdp_probe = 0
+//
+// Returns nothing if the file cannot be read or parsed.
+absl::optional<std::vector<ChannelArgsProfile>> LoadChannelArgsProfiles(
+    const std::string& path);
+
+// Returns the profile of the given name. "default" is the unnamed profile
+// unless the file defines it.
+absl::optional<ChannelArgsProfile> FindChannelArgsProfile(
+    const std::vector<ChannelArgsProfile>& profiles, const std::string& name);
+
+// Sets arguments of the profile. Integer values are set as integers and the
+// others as strings. These take precedence over arguments set before.
+void ApplyChannelArgsProfile(const ChannelArgsProfile& profile,
+                             grpc::ChannelArguments* channel_args);
+
+#endif  // GCS_BENCHMARK_CHANNEL_ARGS_PROFILE_H_
@@ -14,14 +14,22 @@
 
 #include "channel_creator.h"
 
+#include <grpc/grpc_security.h>
 #include <grpcpp/channel.h>
 #include <grpcpp/client_context.h>
 #include <grpcpp/create_channel.h>
+#include <grpcpp/resource_quota.h>
 #include <grpcpp/security/credentials.h>
 
+#include <stdlib.h>
+
 #include <fstream>
+#include <unordered_map>
 
+#include "absl/base/const_init.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
+#include "absl/synchronization/mutex.h"
 
 static std::string LoadStringFromFile(std::string path) {
   std::ifstream file(path);
@@ -34,24 +42,162 @@ static std::string LoadStringFromFile(std::string path) {
   return sstr.str();
 }
 
+// Creates credentials for the network and cred type or the access token.
+static std::shared_ptr<grpc::ChannelCredentials> CreateChannelCredentials(
+    absl::string_view access_token, absl::string_view network,
+    absl::string_view cred, absl::string_view ssl_cert) {
+  if (!access_token.empty()) {
+    std::shared_ptr<grpc::ChannelCredentials> channel_credentials =
+        grpc::SslCredentials(grpc::SslCredentialsOptions());
+    if (access_token == "-") {
+      return channel_credentials;
+    }
+    std::shared_ptr<grpc::CallCredentials> call_credentials =
+        grpc::AccessTokenCredentials(std::string(access_token));
+    return grpc::CompositeChannelCredentials(channel_credentials,
+                                             call_credentials);
+  }
+  if (network == "dp") {
+    grpc::experimental::AltsCredentialsOptions alts_opts;
+    return grpc::CompositeChannelCredentials(
+        grpc::experimental::AltsCredentials(alts_opts),
+        grpc::GoogleComputeEngineCredentials());
+  } else if (network != "cfe" && network != "dp2" && !cred.empty()) {
+    if (cred == "insecure") {
+      return grpc::InsecureChannelCredentials();
+    } else if (cred == "ssl") {
+      if (ssl_cert == "") {
+        return grpc::SslCredentials(grpc::SslCredentialsOptions());
+      } else {
+        grpc::SslCredentialsOptions ssl_options;
+        ssl_options.pem_root_certs = LoadStringFromFile(std::string(ssl_cert));
+        return grpc::SslCredentials(ssl_options);
+      }
+    } else if (cred == "alts") {
+      return grpc::experimental::AltsCredentials(
+          grpc::experimental::AltsCredentialsOptions());
+    }
+  }
+  return grpc::GoogleDefaultCredentials();
+}
+
+// Returns credentials shared by all channels made of the same inputs so that
+// creating a channel doesn't rebuild them or reread the root certificates.
+static std::shared_ptr<grpc::ChannelCredentials> GetCachedChannelCredentials(
+    absl::string_view access_token, absl::string_view network,
+    absl::string_view cred, absl::string_view ssl_cert) {
+  static absl::Mutex lock(absl::kConstInit);
+  static auto* cache = new std::unordered_map<
+      std::string, std::shared_ptr<grpc::ChannelCredentials>>();
+  std::string key =
+      absl::StrCat(access_token, "|", network, "|", cred, "|", ssl_cert);
+  absl::MutexLock l(&lock);
+  auto& channel_cred = (*cache)[key];
+  if (channel_cred == nullptr) {
+    channel_cred =
+        CreateChannelCredentials(access_token, network, cred, ssl_cert);
+  }
+  return channel_cred;
+}
+
+// Lets TLS channels resume sessions of earlier channels to skip the full
+// handshake. The cache is shared by all channels of the process.
+static void SetSslSessionCache(int size, grpc::ChannelArguments* channel_args) {
+  if (size <= 0) {
+    return;
+  }
+  static grpc_ssl_session_cache* cache =
+      grpc_ssl_session_cache_create_lru(size);
+  grpc_arg arg = grpc_ssl_session_cache_create_channel_arg(cache);
+  channel_args->SetPointerWithVtable(arg.key, arg.value.pointer.p,
+                                     arg.value.pointer.vtable);
+}
+
+// Quota shared by all channels. Null unless SetChannelResourceQuota is called.
+static grpc::ResourceQuota* channel_resource_quota = nullptr;
+
+void SetChannelResourceQuota(int64_t memory_bytes) {
+  if (memory_bytes <= 0) {
+    return;
+  }
+  auto* quota = new grpc::ResourceQuota("benchmark");
+  quota->Resize(memory_bytes);
+  channel_resource_quota = quota;
+}
+
+void SetXdsBootstrap(absl::string_view server_uri) {
+  if (server_uri.empty()) {
+    return;
+  }
+  std::string bootstrap = absl::StrFormat(
+      "{\"xds_servers\":[{\"server_uri\":\"%s\","
+      "\"channel_creds\":[{\"type\":\"insecure\"}],"
+      "\"server_features\":[\"xds_v3\"]}],"
+      "\"node\":{\"id\":\"gcs-benchmark\"}}",
+      server_uri);
+  setenv("GRPC_XDS_BOOTSTRAP_CONFIG", bootstrap.c_str(), 1);
+}
+
+bool ParseCompressionAlgorithm(absl::string_view name,
+                               grpc_compression_algorithm* algorithm) {
+  if (name == "none") {
+    *algorithm = GRPC_COMPRESS_NONE;
+  } else if (name == "deflate") {
+    *algorithm = GRPC_COMPRESS_DEFLATE;
+  } else if (name == "gzip") {
+    *algorithm = GRPC_COMPRESS_GZIP;
+  } else {
+    return false;
+  }
+  return true;
+}
+
 std::shared_ptr<grpc::Channel> CreateGrpcChannel(absl::string_view host,
                                                  absl::string_view access_token,
                                                  absl::string_view network,
                                                  absl::string_view cred,
                                                  absl::string_view ssl_cert,
-                                                 bool use_rr, bool use_td,
-                                                 bool use_tx_zerocopy) {
+                                                 bool use_rr, bool use_wrr,
+                                                 bool use_td,
+                                                 bool use_tx_zerocopy,
+                                                 bool cache_credentials,
+                                                 int ssl_session_cache_size,
+                                                 absl::string_view compression,
+                                                 const ChannelArgsProfile&
+                                                     channel_args_profile) {
   std::string target = std::string(host);
   if (target.empty()) {
     target = "storage.googleapis.com";
   }
   if (use_td) {
     target = "google-c2p:///" + target;
+  } else if (network == "uds") {
+    // The host is the path of the Unix domain socket of the server.
+    target = "unix:" + target;
+  } else if (network == "xds") {
+    // The xDS server in the bootstrap resolves the host to backends.
+    target = "xds:///" + target;
+  }
+  std::shared_ptr<grpc::ChannelCredentials> channel_cred =
+      cache_credentials
+          ? GetCachedChannelCredentials(access_token, network, cred, ssl_cert)
+          : CreateChannelCredentials(access_token, network, cred, ssl_cert);
+  grpc::ChannelArguments channel_args;
+  // Use a local subchannel pool to avoid contention in gRPC. This also keeps
+  // channels sharing cached credentials from sharing a connection.
+  channel_args.SetInt(GRPC_ARG_USE_LOCAL_SUBCHANNEL_POOL, 1);
+  SetSslSessionCache(ssl_session_cache_size, &channel_args);
+  if (channel_resource_quota != nullptr) {
+    channel_args.SetResourceQuota(*channel_resource_quota);
   }
   if (access_token.empty()) {
-    std::shared_ptr<grpc::ChannelCredentials> channel_cred;
-    grpc::ChannelArguments channel_args;
-    if (!use_td) {
+    if (use_wrr) {
+      // Weights come from ORCA reports in responses of backends and get
+      // updated every second after a short blackout for new backends.
+      channel_args.SetServiceConfigJSON(
+          "{\"loadBalancingConfig\":[{\"weighted_round_robin\":{"
+          "\"blackoutPeriod\":\"1s\",\"weightUpdatePeriod\":\"1s\"}}]}");
+    } else if (!use_td && network != "xds") {
       const char* policy = use_rr ? "round_robin" : "pick_first";
       channel_args.SetServiceConfigJSON(
           absl::StrFormat("{\"loadBalancingConfig\":[{\"grpclb\":{"
@@ -64,43 +210,16 @@ std::shared_ptr<grpc::Channel> CreateGrpcChannel(absl::string_view host,
         channel_args.SetInt("grpc.dns_enable_srv_queries",
                             0);  // Disable DirectPath
       }
-    } else if (network == "dp") {
-      grpc::experimental::AltsCredentialsOptions alts_opts;
-      channel_cred = grpc::CompositeChannelCredentials(
-          grpc::experimental::AltsCredentials(alts_opts),
-          grpc::GoogleComputeEngineCredentials());
+    } else if (network == "dp" || network == "dp2") {
       if (!use_td) {
         channel_args.SetInt("grpc.dns_enable_srv_queries",
                             1);  // Enable DirectPath
       }
-    } else if (network == "dp2") {
-      channel_cred = grpc::GoogleDefaultCredentials();
-      if (!use_td) {
-        channel_args.SetInt("grpc.dns_enable_srv_queries",
-                            1);  // Enable DirectPath
-      }
-    } else {
-      if (!cred.empty()) {
-        if (cred == "insecure") {
-          channel_cred = grpc::InsecureChannelCredentials();
-        } else if (cred == "ssl") {
-          if (ssl_cert == "") {
-            channel_cred = grpc::SslCredentials(grpc::SslCredentialsOptions());
-          } else {
-            grpc::SslCredentialsOptions ssl_options;
-            ssl_options.pem_root_certs =
-                LoadStringFromFile(std::string(ssl_cert));
-            channel_cred = grpc::SslCredentials(ssl_options);
-          }
-        } else if (cred == "alts") {
-          channel_cred = grpc::experimental::AltsCredentials(
-              grpc::experimental::AltsCredentialsOptions());
-        }
-      }
+    } else if (network == "grpclb") {
+      // Balancers are found through SRV records of the host.
+      channel_args.SetInt("grpc.dns_enable_srv_queries", 1);
     }
 
-    // Use a local subchannel pool to avoid contention in gRPC.
-    channel_args.SetInt(GRPC_ARG_USE_LOCAL_SUBCHANNEL_POOL, 1);
     // Effectively disable keepalive messages.
     auto constexpr kDisableKeepaliveTime =
         std::chrono::milliseconds(std::chrono::hours(24));
@@ -116,27 +235,14 @@ std::shared_ptr<grpc::Channel> CreateGrpcChannel(absl::string_view host,
     if (use_tx_zerocopy) {
       channel_args.SetInt(GRPC_ARG_TCP_TX_ZEROCOPY_ENABLED, 1);
     }
-
-    if (channel_cred == nullptr) {
-      channel_cred = grpc::GoogleDefaultCredentials();
-    }
-    std::shared_ptr<grpc::Channel> channel =
-        grpc::CreateCustomChannel(target, channel_cred, channel_args);
-    return channel;
-  } else {
-    std::shared_ptr<grpc::ChannelCredentials> credentials;
-    std::shared_ptr<grpc::ChannelCredentials> channel_credentials =
-        grpc::SslCredentials(grpc::SslCredentialsOptions());
-    if (access_token == "-") {
-      credentials = channel_credentials;
-    } else {
-      std::shared_ptr<grpc::CallCredentials> call_credentials =
-          grpc::AccessTokenCredentials(std::string(access_token));
-      credentials = grpc::CompositeChannelCredentials(channel_credentials,
-                                                      call_credentials);
-    }
-    std::shared_ptr<grpc::Channel> channel =
-        grpc::CreateChannel(target, credentials);
-    return channel;
   }
+  // Messages sent on the channel get compressed unless a call overrides it.
+  grpc_compression_algorithm compression_algorithm;
+  if (ParseCompressionAlgorithm(compression, &compression_algorithm)) {
+    channel_args.SetCompressionAlgorithm(compression_algorithm);
+  }
+  ApplyChannelArgsProfile(channel_args_profile, &channel_args);
+  std::shared_ptr<grpc::Channel> channel =
+      grpc::CreateCustomChannel(target, channel_cred, channel_args);
+  return channel;
 }
@@ -15,18 +15,44 @@
 #ifndef GCS_BENCHMARK_CHANNEL_CREATOR_H_
 #define GCS_BENCHMARK_CHANNEL_CREATOR_H_
 
+#include <grpc/compression.h>
 #include <grpcpp/channel.h>
 
+#include <cstdint>
 #include <memory>
 
 #include "absl/strings/string_view.h"
+#include "channel_args_profile.h"
 
+// Channels share credentials made of the same inputs if cache_credentials is
+// set and resume TLS sessions from a process-wide cache holding
+// ssl_session_cache_size sessions (0 disables it).
 std::shared_ptr<grpc::Channel> CreateGrpcChannel(absl::string_view host,
                                                  absl::string_view access_token,
                                                  absl::string_view network,
                                                  absl::string_view cred,
                                                  absl::string_view ssl_cert,
-                                                 bool use_rr, bool use_td,
-                                                 bool use_tx_zerocopy);
+                                                 bool use_rr, bool use_wrr,
+                                                 bool use_td,
+                                                 bool use_tx_zerocopy,
+                                                 bool cache_credentials,
+                                                 int ssl_session_cache_size,
+                                                 absl::string_view compression,
+                                                 const ChannelArgsProfile&
+                                                     channel_args_profile = {});
+
+// Makes channels created afterwards share one resource quota which caps
+// the memory gRPC may use for them. Zero leaves it unlimited.
+void SetChannelResourceQuota(int64_t memory_bytes);
+
+// Makes xds targets resolve through the xDS server at server_uri, which
+// must be set before gRPC starts. Empty leaves the bootstrap to the
+// GRPC_XDS_BOOTSTRAP environment variable.
+void SetXdsBootstrap(absl::string_view server_uri);
+
+// Parses a compression algorithm name (none, deflate, gzip). Returns false
+// for unknown names.
+bool ParseCompressionAlgorithm(absl::string_view name,
+                               grpc_compression_algorithm* algorithm);
 
 #endif  // GCS_BENCHMARK_CHANNEL_CREATOR_H_
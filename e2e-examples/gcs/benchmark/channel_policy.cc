@@ -14,95 +14,383 @@
 
 #include "channel_policy.h"
 
+#include <atomic>
+#include <cmath>
+#include <random>
+#include <thread>
 #include <unordered_map>
+#include <unordered_set>
 
+#include "absl/memory/memory.h"
+#include "absl/strings/str_format.h"
 #include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
 #include "channel_poller.h"
 
-class ConstChannelPool : public StorageStubProvider {
+namespace {
+
+// Channel with its stub and id which are created once and shared by all calls
+// made on the channel. Its connectivity state is kept up to date by the
+// shared channel poller. A channel created for a single call has no slot to
+// track, so it gets neither an id nor a watch.
+struct PooledChannel {
+  explicit PooledChannel(std::shared_ptr<grpc::Channel> c, bool pooled = true)
+      : channel(std::move(c)),
+        stub(google::storage::v2::Storage::NewStub(channel)),
+        id(pooled ? NextChannelId() : 0),
+        created_time(absl::Now()) {
+    if (pooled) {
+      watch_id = ChannelPoller::Default()->Watch(
+          channel, [this](grpc_connectivity_state s) { state = s; });
+    }
+  }
+
+  ~PooledChannel() {
+    if (watch_id != 0) {
+      ChannelPoller::Default()->Unwatch(watch_id);
+    }
+  }
+
+  StorageStubProvider::StubHolder ToStubHolder() const {
+    return StorageStubProvider::StubHolder{stub, (void*)channel.get(), id};
+  }
+
+  // Returns true if calls on this channel are likely to fail right away.
+  bool IsFailing() const {
+    return state.load(std::memory_order_relaxed) ==
+           GRPC_CHANNEL_TRANSIENT_FAILURE;
+  }
+
+  static int64_t NextChannelId() {
+    static std::atomic<int64_t> next_id(1);
+    return next_id.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  std::shared_ptr<grpc::Channel> channel;
+  std::shared_ptr<google::storage::v2::Storage::Stub> stub;
+  int64_t id;
+  absl::Time created_time;
+  int64_t watch_id = 0;
+  std::atomic<grpc_connectivity_state> state{GRPC_CHANNEL_IDLE};
+};
+
+// Channel being replaced by the channel creator running on this thread.
+thread_local const grpc::Channel* replaced_channel = nullptr;
+
+// Replaces channels in the make-before-break way. A new channel gets
+// connected in the background and then handed to the swap function, so the
+// old one keeps serving calls until then. Calls in flight on the old channel
+// hold it through their stubs so they finish on it.
+class ChannelReplacer {
  public:
-  ConstChannelPool(
-      std::function<std::shared_ptr<grpc::Channel>()> channel_creator)
-      : channel_creator_(channel_creator) {
-    channel_ = channel_creator();
-    channel_poller_.reset(new ChannelPoller(channel_));
+  // Puts the new channel in place of the one having the key and returns the
+  // id of the new one, or 0 if the key is gone.
+  using Swap = std::function<int64_t(std::shared_ptr<grpc::Channel>)>;
+
+  ChannelReplacer(
+      std::function<std::shared_ptr<grpc::Channel>()> channel_creator,
+      std::shared_ptr<RunnerWatcher> watcher)
+      : channel_creator_(channel_creator), watcher_(watcher) {}
+
+  ~ChannelReplacer() {
+    for (auto& r : replacements_) {
+      r->thread.join();
+    }
+  }
+
+  // Starts replacing the channel having the key and reports it as an evict
+  // event for the reason. Returns false if it's already being replaced. The
+  // channel creator can tell the replaced channel from GetReplacedChannel()
+  // while creating the new one.
+  bool Start(void* key, const PooledChannel& channel,
+             const std::string& reason, Swap swap) {
+    absl::MutexLock l(&lock_);
+    if (!replacing_.insert(key).second) {
+      return false;
+    }
+    if (watcher_ != nullptr) {
+      watcher_->NotifyEvent("evict", channel.id, reason);
+    }
+    const grpc::Channel* replaced = channel.channel.get();
+
+    // Cleans up replacements done so far.
+    replacements_.erase(
+        std::remove_if(replacements_.begin(), replacements_.end(),
+                       [](const std::unique_ptr<Replacement>& r) {
+                         if (!r->done) {
+                           return false;
+                         }
+                         r->thread.join();
+                         return true;
+                       }),
+        replacements_.end());
+
+    auto replacement = absl::make_unique<Replacement>();
+    Replacement* r = replacement.get();
+    r->thread = std::thread([this, key, replaced, swap, r]() {
+      absl::Time start = absl::Now();
+      replaced_channel = replaced;
+      auto channel = channel_creator_();
+      replaced_channel = nullptr;
+      channel->GetState(true);
+      bool ready = channel->WaitForConnected(
+          absl::ToChronoTime(start + kConnectTimeout));
+      // Swaps anyway after the timeout since the old one is likely broken.
+      int64_t id = swap(std::move(channel));
+      if (watcher_ != nullptr) {
+        watcher_->NotifyEvent(
+            "evict_swap", absl::ToInt64Milliseconds(absl::Now() - start),
+            absl::StrFormat("channel_id=%d ready=%s", id,
+                            ready ? "true" : "false"));
+      }
+      absl::MutexLock l(&lock_);
+      replacing_.erase(key);
+      r->done = true;
+    });
+    replacements_.push_back(std::move(replacement));
+    return true;
+  }
+
+ private:
+  struct Replacement {
+    std::thread thread;
+    bool done = false;
+  };
+
+  static constexpr absl::Duration kConnectTimeout = absl::Seconds(10);
+
+  std::function<std::shared_ptr<grpc::Channel>()> channel_creator_;
+  std::shared_ptr<RunnerWatcher> watcher_;
+  absl::Mutex lock_;
+  std::unordered_set<void*> replacing_ ABSL_GUARDED_BY(lock_);
+  std::vector<std::unique_ptr<Replacement>> replacements_
+      ABSL_GUARDED_BY(lock_);
+};
+
+// List of pooled channels which can be read without a lock. Replacing a
+// channel publishes a new copy of the list (RCU-style) so readers never wait
+// and calls in flight keep using the old channel until they finish.
+class ChannelList {
+ public:
+  using Snapshot = std::vector<std::shared_ptr<const PooledChannel>>;
+
+  ChannelList(std::function<std::shared_ptr<grpc::Channel>()> channel_creator,
+              int size, std::shared_ptr<RunnerWatcher> watcher)
+      : replacer_(channel_creator, watcher) {
+    auto channels = std::make_shared<Snapshot>();
+    for (int i = 0; i < size; i++) {
+      channels->push_back(std::make_shared<PooledChannel>(channel_creator()));
+    }
+    channels_ = std::move(channels);
+  }
+
+  std::shared_ptr<const Snapshot> GetSnapshot() const {
+    return std::atomic_load(&channels_);
+  }
+
+  // Returns the channel at the cursor or the next one which is not failing.
+  // If all are failing, the one at the cursor is returned.
+  std::shared_ptr<const PooledChannel> Pick(size_t cursor) const {
+    auto channels = GetSnapshot();
+    size_t n = channels->size();
+    for (size_t i = 0; i < n; i++) {
+      const auto& channel = (*channels)[(cursor + i) % n];
+      if (!channel->IsFailing()) {
+        return channel;
+      }
+    }
+    return (*channels)[cursor % n];
+  }
+
+  // Evicts the channel having the handle in the make-before-break way.
+  // Returns false if there is no such channel or it's already being evicted.
+  // The channel stays listed until it's replaced, so the new one is never
+  // created for a handle which is gone.
+  bool Evict(void* handle, const std::string& reason) {
+    absl::MutexLock l(&write_lock_);
+    auto channels = GetSnapshot();
+    size_t i = Find(*channels, handle);
+    if (i == channels->size() ||
+        !replacer_.Start(handle, *(*channels)[i], reason,
+                         [this, handle](std::shared_ptr<grpc::Channel> c) {
+                           return Replace(handle, std::move(c));
+                         })) {
+      return false;
+    }
+    return true;
+  }
+
+ private:
+  // Replaces the channel having the handle with the given one and returns
+  // the id of the new one. Returns 0 if there is no such channel.
+  int64_t Replace(void* handle, std::shared_ptr<grpc::Channel> channel) {
+    absl::MutexLock l(&write_lock_);
+    auto channels = std::make_shared<Snapshot>(*GetSnapshot());
+    size_t i = Find(*channels, handle);
+    if (i == channels->size()) {
+      return 0;
+    }
+    (*channels)[i] = std::make_shared<PooledChannel>(std::move(channel));
+    int64_t id = (*channels)[i]->id;
+    std::atomic_store(&channels_,
+                      std::shared_ptr<const Snapshot>(std::move(channels)));
+    return id;
+  }
+
+  // Returns the index of the channel having the handle or the size of the
+  // list if there is no such channel.
+  static size_t Find(const Snapshot& channels, void* handle) {
+    for (size_t i = 0; i < channels.size(); i++) {
+      if ((void*)channels[i]->channel.get() == handle) {
+        return i;
+      }
+    }
+    return channels.size();
   }
 
-  ~ConstChannelPool() {
-    // Resetting channel_ first so that channel can be destroyed when
-    // channel_poller is destroyed.
-    channel_.reset();
+ private:
+  absl::Mutex write_lock_;
+  std::shared_ptr<const Snapshot> channels_;
+  // Declared last so that replacements in progress finish before the list
+  // goes away.
+  ChannelReplacer replacer_;
+};
+
+}  // namespace
+
+const grpc::Channel* GetReplacedChannel() { return replaced_channel; }
+
+const char* ToString(TrafficClass traffic_class) {
+  switch (traffic_class) {
+    case TrafficClass::kBulk:
+      return "bulk";
+    case TrafficClass::kLatency:
+      return "latency";
+  }
+  return "unknown";
+}
+
+class ConstChannelPool : public StorageStubProvider {
+ public:
+  ConstChannelPool(
+      std::function<std::shared_ptr<grpc::Channel>()> channel_creator,
+      std::shared_ptr<RunnerWatcher> watcher)
+      : replacer_(channel_creator, watcher) {
+    channel_ = std::make_shared<PooledChannel>(channel_creator());
   }
 
   StorageStubProvider::StubHolder GetStorageStub() override {
-    StorageStubProvider::StubHolder holder = {
-        google::storage::v2::Storage::NewStub(channel_), (void*)channel_.get()};
-    return holder;
+    return std::atomic_load(&channel_)->ToStubHolder();
   }
 
   void ReportResult(void* handle, const grpc::Status& status,
                     const grpc::ClientContext& context,
                     absl::Duration elapsed_time, int64_t bytes) override {
-    if (status.error_code() == grpc::StatusCode::CANCELLED) {
-      channel_ = channel_creator_();
+    // Replaces the channel only if the call was made on the current one.
+    auto channel = std::atomic_load(&channel_);
+    if (status.error_code() == grpc::StatusCode::CANCELLED &&
+        (void*)channel->channel.get() == handle) {
+      replacer_.Start(handle, *channel,
+                      absl::StrFormat("peer=%s error=%d", context.peer(),
+                                      status.error_code()),
+                      [this, handle](std::shared_ptr<grpc::Channel> c) {
+        auto current = std::atomic_load(&channel_);
+        if ((void*)current->channel.get() != handle) {
+          return int64_t(0);
+        }
+        std::shared_ptr<const PooledChannel> replaced =
+            std::make_shared<PooledChannel>(std::move(c));
+        std::atomic_store(&channel_, replaced);
+        return replaced->id;
+      });
     }
   }
 
  private:
-  std::function<std::shared_ptr<grpc::Channel>()> channel_creator_;
-  std::shared_ptr<grpc::Channel> channel_;
-  std::unique_ptr<ChannelPoller> channel_poller_;
+  std::shared_ptr<const PooledChannel> channel_;
+  // Declared last so that replacements in progress finish first.
+  ChannelReplacer replacer_;
 };
 
 std::shared_ptr<StorageStubProvider> CreateConstChannelPool(
-    std::function<std::shared_ptr<grpc::Channel>()> channel_creator) {
-  return std::make_shared<ConstChannelPool>(channel_creator);
+    std::function<std::shared_ptr<grpc::Channel>()> channel_creator,
+    std::shared_ptr<RunnerWatcher> watcher) {
+  return std::make_shared<ConstChannelPool>(channel_creator, watcher);
 }
 
+// Creates a channel for every call. The channel gets connected before the
+// call so that its setup is reported apart from the call.
 class CreateNewChannelStubProvider : public StorageStubProvider {
  public:
   CreateNewChannelStubProvider(
-      std::function<std::shared_ptr<grpc::Channel>()> channel_creator)
-      : channel_creator_(channel_creator) {}
+      std::function<std::shared_ptr<grpc::Channel>()> channel_creator,
+      std::shared_ptr<RunnerWatcher> watcher)
+      : channel_creator_(channel_creator), watcher_(watcher) {}
 
   StorageStubProvider::StubHolder GetStorageStub() override {
+    RunnerWatcher::ChannelSetup setup;
+    setup.time = absl::Now();
     auto channel = channel_creator_();
-    StorageStubProvider::StubHolder holder = {
-        google::storage::v2::Storage::NewStub(channel), (void*)channel.get()};
-    return holder;
+    setup.create_time = absl::Now() - setup.time;
+    // Starts connecting without waiting for it. The call waits for the
+    // connection itself so that it counts in the call rather than stalling
+    // the thread before the call.
+    channel->GetState(true);
+    if (watcher_ != nullptr) {
+      absl::MutexLock l(&lock_);
+      setups_[channel.get()] = setup;
+    }
+    return PooledChannel(std::move(channel), false).ToStubHolder();
   }
 
   void ReportResult(void* handle, const grpc::Status& status,
                     const grpc::ClientContext& context,
-                    absl::Duration elapsed_time, int64_t bytes) override {}
+                    absl::Duration elapsed_time, int64_t bytes) override {
+    if (watcher_ == nullptr) {
+      return;
+    }
+    RunnerWatcher::ChannelSetup setup;
+    {
+      absl::MutexLock l(&lock_);
+      auto i = setups_.find(handle);
+      if (i == setups_.end()) {
+        return;
+      }
+      setup = i->second;
+      setups_.erase(i);
+    }
+    // The only call of the channel includes connecting it and a channel
+    // which failed to connect fails its call as UNAVAILABLE.
+    setup.first_call_time = elapsed_time;
+    setup.connected = status.error_code() != grpc::StatusCode::UNAVAILABLE;
+    watcher_->NotifyChannelSetup(setup);
+  }
 
  private:
   std::function<std::shared_ptr<grpc::Channel>()> channel_creator_;
+  std::shared_ptr<RunnerWatcher> watcher_;
+  absl::Mutex lock_;
+  // Setups of channels whose call has not been reported yet
+  std::unordered_map<void*, RunnerWatcher::ChannelSetup> setups_;
 };
 
 std::shared_ptr<StorageStubProvider> CreateCreateNewChannelStubProvider(
-    std::function<std::shared_ptr<grpc::Channel>()> channel_creator) {
-  return std::make_shared<CreateNewChannelStubProvider>(channel_creator);
+    std::function<std::shared_ptr<grpc::Channel>()> channel_creator,
+    std::shared_ptr<RunnerWatcher> watcher) {
+  return std::make_shared<CreateNewChannelStubProvider>(channel_creator,
+                                                        watcher);
 }
 
 class RoundRobinChannelPool : public StorageStubProvider {
  public:
   RoundRobinChannelPool(
       std::function<std::shared_ptr<grpc::Channel>()> channel_creator,
-      int size) {
-    channel_creator_ = channel_creator;
-    for (int i = 0; i < size; i++) {
-      channels_.push_back(channel_creator());
-    }
-  }
+      int size, std::shared_ptr<RunnerWatcher> watcher)
+      : channels_(channel_creator, size, watcher) {}
 
   StorageStubProvider::StubHolder GetStorageStub() override {
-    absl::MutexLock l(&lock_);
-    cursor_ = (cursor_ + 1) % channels_.size();
-    StorageStubProvider::StubHolder holder = {
-        google::storage::v2::Storage::NewStub(channels_[cursor_]),
-        (void*)channels_[cursor_].get()};
-    return holder;
+    size_t cursor = cursor_.fetch_add(1, std::memory_order_relaxed);
+    return channels_.Pick(cursor)->ToStubHolder();
   }
 
   void ReportResult(void* handle, const grpc::Status& status,
@@ -110,58 +398,54 @@ class RoundRobinChannelPool : public StorageStubProvider {
                     absl::Duration elapsed_time, int64_t bytes) override {
     if (status.error_code() == grpc::StatusCode::CANCELLED ||
         status.error_code() == grpc::StatusCode::DEADLINE_EXCEEDED) {
-      auto i = std::find_if(channels_.begin(), channels_.end(),
-                            [handle](std::shared_ptr<grpc::Channel> val) {
-                              return (void*)val.get() == handle;
-                            });
-      if (i != channels_.end()) {
+      if (channels_.Evict(handle, absl::StrFormat("peer=%s error=%d",
+                                                  context.peer(),
+                                                  status.error_code()))) {
         std::cout << "Evict the channel (peer=" << context.peer()
                   << ") due to error:" << status.error_code() << std::endl;
-        *i = channel_creator_();
       }
     }
   }
 
  private:
-  absl::Mutex lock_;
-  std::function<std::shared_ptr<grpc::Channel>()> channel_creator_;
-  std::vector<std::shared_ptr<grpc::Channel>> channels_;
-  int cursor_ = 0;
+  ChannelList channels_;
+  std::atomic<size_t> cursor_{0};
 };
 
 std::shared_ptr<StorageStubProvider> CreateRoundRobinChannelPool(
-    std::function<std::shared_ptr<grpc::Channel>()> channel_creator, int size) {
-  return std::make_shared<RoundRobinChannelPool>(channel_creator, size);
+    std::function<std::shared_ptr<grpc::Channel>()> channel_creator, int size,
+    std::shared_ptr<RunnerWatcher> watcher) {
+  return std::make_shared<RoundRobinChannelPool>(channel_creator, size,
+                                                 watcher);
 }
 
 class RoundRobinPlusChannelPool : public StorageStubProvider {
  public:
   RoundRobinPlusChannelPool(
       std::function<std::shared_ptr<grpc::Channel>()> channel_creator,
-      int size) {
-    channel_creator_ = channel_creator;
+      int size, std::shared_ptr<RunnerWatcher> watcher)
+      : replacer_(channel_creator, watcher) {
     for (int i = 0; i < size; i++) {
-      channel_states_.push_back(ChannelState{channel_creator(), 0});
+      channel_states_.push_back(
+          ChannelState{std::make_shared<PooledChannel>(channel_creator()), 0});
     }
   }
 
   StorageStubProvider::StubHolder GetStorageStub() override {
     absl::MutexLock l(&lock_);
 
-    // Finds the channel with the least number of use.
+    // Finds the channel with the least number of use, avoiding failing ones.
     auto least = channel_states_.begin();
     for (auto i = channel_states_.begin(); i != channel_states_.end(); ++i) {
-      if (i->in_use_count < least->in_use_count) {
+      if (std::make_pair(i->channel->IsFailing(), i->in_use_count) <
+          std::make_pair(least->channel->IsFailing(), least->in_use_count)) {
         least = i;
       }
     }
 
     // Increases in-use count for the channel to be returned.
     least->in_use_count += 1;
-    StorageStubProvider::StubHolder holder = {
-        google::storage::v2::Storage::NewStub(least->channel),
-        (void*)least->channel.get()};
-    return holder;
+    return least->channel->ToStubHolder();
   }
 
   void ReportResult(void* handle, const grpc::Status& status,
@@ -170,68 +454,410 @@ class RoundRobinPlusChannelPool : public StorageStubProvider {
     absl::MutexLock l(&lock_);
 
     // Decreases in-use count for the channel
-    auto i = std::find_if(channel_states_.begin(), channel_states_.end(),
-                          [handle](const ChannelState& val) {
-                            return (void*)val.channel.get() == handle;
-                          });
-    if (i != channel_states_.end()) {
-      i->in_use_count -= 1;
+    auto i = FindState(handle);
+    if (i == channel_states_.end()) {
+      return;
     }
+    i->in_use_count -= 1;
 
     // If the error indicates that the channel is hopeless,
     // replace it with the newly created one.
     if (status.error_code() == grpc::StatusCode::CANCELLED ||
         status.error_code() == grpc::StatusCode::DEADLINE_EXCEEDED) {
-      auto i = std::find_if(channel_states_.begin(), channel_states_.end(),
-                            [handle](const ChannelState& val) {
-                              return (void*)val.channel.get() == handle;
-                            });
-      if (i != channel_states_.end()) {
+      if (replacer_.Start(handle, *i->channel,
+                          absl::StrFormat("peer=%s error=%d", context.peer(),
+                                          status.error_code()),
+                          [this, handle](std::shared_ptr<grpc::Channel> c) {
+                            return SwapChannel(handle, std::move(c));
+                          })) {
         std::cerr << "Evict the channel (peer=" << context.peer()
                   << ") due to error:" << status.error_code() << std::endl;
-        i->channel = channel_creator_();
-        i->in_use_count = 0;
       }
     }
   }
 
  private:
-  absl::Mutex lock_;
-  std::function<std::shared_ptr<grpc::Channel>()> channel_creator_;
-
   struct ChannelState {
-    std::shared_ptr<grpc::Channel> channel;
+    std::shared_ptr<const PooledChannel> channel;
     int32_t in_use_count;
   };
-  std::vector<ChannelState> channel_states_;
+
+  std::vector<ChannelState>::iterator FindState(void* handle)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(lock_) {
+    return std::find_if(channel_states_.begin(), channel_states_.end(),
+                        [handle](const ChannelState& val) {
+                          return (void*)val.channel->channel.get() == handle;
+                        });
+  }
+
+  int64_t SwapChannel(void* handle, std::shared_ptr<grpc::Channel> channel) {
+    absl::MutexLock l(&lock_);
+    auto i = FindState(handle);
+    if (i == channel_states_.end()) {
+      return 0;
+    }
+    i->channel = std::make_shared<PooledChannel>(std::move(channel));
+    i->in_use_count = 0;
+    return i->channel->id;
+  }
+
+  absl::Mutex lock_;
+  std::vector<ChannelState> channel_states_ ABSL_GUARDED_BY(lock_);
+  // Declared last so that replacements in progress finish first.
+  ChannelReplacer replacer_;
 };
 
 std::shared_ptr<StorageStubProvider> CreateRoundRobinPlusChannelPool(
-    std::function<std::shared_ptr<grpc::Channel>()> channel_creator, int size) {
-  return std::make_shared<RoundRobinPlusChannelPool>(channel_creator, size);
+    std::function<std::shared_ptr<grpc::Channel>()> channel_creator, int size,
+    std::shared_ptr<RunnerWatcher> watcher) {
+  return std::make_shared<RoundRobinPlusChannelPool>(channel_creator, size,
+                                                     watcher);
 }
 
-class SmartRoundRobinChannelPool : public StorageStubProvider {
+class PowerOfTwoChoicesChannelPool : public StorageStubProvider {
  public:
-  SmartRoundRobinChannelPool(
+  PowerOfTwoChoicesChannelPool(
       std::function<std::shared_ptr<grpc::Channel>()> channel_creator,
-      int size) {
-    channel_creator_ = channel_creator;
-    for (int i = 0; i < size; i++) {
-      channels_.push_back(channel_creator());
+      int size, std::shared_ptr<RunnerWatcher> watcher)
+      : slots_(size), replacer_(channel_creator, watcher) {
+    for (auto& slot : slots_) {
+      slot.channel = std::make_shared<PooledChannel>(channel_creator());
     }
-    InitChannelStateMap();
   }
 
   StorageStubProvider::StubHolder GetStorageStub() override {
-    absl::MutexLock l(&lock_);
-    cursor_ = (cursor_ + 1) % channels_.size();
-    StorageStubProvider::StubHolder holder = {
-        google::storage::v2::Storage::NewStub(channels_[cursor_]),
-        (void*)channels_[cursor_].get()};
+    // Samples two distinct slots and picks the one with the lower load.
+    // Slots never move so the handle is the slot itself.
+    thread_local std::minstd_rand rand(std::random_device{}());
+    size_t n = slots_.size();
+    Slot* slot = &slots_[rand() % n];
+    if (n > 1) {
+      size_t i = slot - slots_.data();
+      size_t j = rand() % (n - 1);
+      Slot* other = &slots_[j >= i ? j + 1 : j];
+      bool slot_failing = std::atomic_load(&slot->channel)->IsFailing();
+      bool other_failing = std::atomic_load(&other->channel)->IsFailing();
+      if (slot_failing != other_failing) {
+        if (slot_failing) {
+          slot = other;
+        }
+      } else if (GetLoad(*other) < GetLoad(*slot)) {
+        slot = other;
+      }
+    }
+    slot->in_flight.fetch_add(1, std::memory_order_relaxed);
+    auto holder = std::atomic_load(&slot->channel)->ToStubHolder();
+    holder.handle = slot;
     return holder;
   }
 
+  void ReportResult(void* handle, const grpc::Status& status,
+                    const grpc::ClientContext& context,
+                    absl::Duration elapsed_time, int64_t bytes) override {
+    Slot* slot = static_cast<Slot*>(handle);
+    slot->in_flight.fetch_sub(1, std::memory_order_relaxed);
+    if (status.ok()) {
+      Observe(slot, elapsed_time, bytes);
+    }
+    if (status.error_code() == grpc::StatusCode::CANCELLED ||
+        status.error_code() == grpc::StatusCode::DEADLINE_EXCEEDED) {
+      // Replaces the channel only if the call was made on it, not on one
+      // which has already been replaced by another failed call.
+      auto channel = std::atomic_load(&slot->channel);
+      if (channel->created_time > absl::Now() - elapsed_time) {
+        return;
+      }
+      if (replacer_.Start(
+              slot, *channel,
+              absl::StrFormat("peer=%s error=%d", context.peer(),
+                              status.error_code()),
+              [slot, channel](std::shared_ptr<grpc::Channel> c) {
+                auto expected = channel;
+                std::shared_ptr<const PooledChannel> new_channel =
+                    std::make_shared<PooledChannel>(std::move(c));
+                if (!std::atomic_compare_exchange_strong(
+                        &slot->channel, &expected, new_channel)) {
+                  return int64_t(0);
+                }
+                absl::MutexLock l(&slot->lock);
+                slot->cost.store(0, std::memory_order_relaxed);
+                return new_channel->id;
+              })) {
+        std::cout << "Evict the channel (peer=" << context.peer()
+                  << ") due to error:" << status.error_code() << std::endl;
+      }
+    }
+  }
+
+ protected:
+  struct Slot {
+    std::shared_ptr<const PooledChannel> channel;
+    std::atomic<int32_t> in_flight{0};
+    // Cost of the channel used by the subclass. Updates are serialized by
+    // the lock while picks read it without one. Zero means no sample yet.
+    absl::Mutex lock;
+    std::atomic<double> cost{0};
+    std::atomic<int64_t> cost_time_ns{0};
+  };
+
+  virtual double GetLoad(Slot& slot) {
+    return slot.in_flight.load(std::memory_order_relaxed);
+  }
+
+  virtual void Observe(Slot* slot, absl::Duration elapsed_time,
+                       int64_t bytes) {}
+
+  std::vector<Slot> slots_;
+
+ private:
+  // Declared last so that replacements in progress finish first.
+  ChannelReplacer replacer_;
+};
+
+std::shared_ptr<StorageStubProvider> CreatePowerOfTwoChoicesChannelPool(
+    std::function<std::shared_ptr<grpc::Channel>()> channel_creator, int size,
+    std::shared_ptr<RunnerWatcher> watcher) {
+  return std::make_shared<PowerOfTwoChoicesChannelPool>(channel_creator, size,
+                                                        watcher);
+}
+
+// Picks channels by their expected cost which is the peak EWMA of the time
+// taken per byte multiplied by the number of calls in flight plus one.
+// Slow samples are taken at once while fast ones are blended in gradually
+// so that a slow channel gets less traffic quickly and recovers slowly.
+// Channels without samples are costed at the mean of the sampled ones, or
+// zero before any sample, so that all loads are in the same unit.
+class PeakEwmaChannelPool : public PowerOfTwoChoicesChannelPool {
+ public:
+  using PowerOfTwoChoicesChannelPool::PowerOfTwoChoicesChannelPool;
+
+ protected:
+  double GetLoad(Slot& slot) override {
+    int32_t in_flight = slot.in_flight.load(std::memory_order_relaxed);
+    double cost = slot.cost.load(std::memory_order_relaxed);
+    if (cost == 0) {
+      return mean_cost_.load(std::memory_order_relaxed) * (in_flight + 1);
+    }
+    absl::Time cost_time = absl::FromUnixNanos(
+        slot.cost_time_ns.load(std::memory_order_relaxed));
+    return Decay(cost, absl::Now() - cost_time) * (in_flight + 1);
+  }
+
+  void Observe(Slot* slot, absl::Duration elapsed_time,
+               int64_t bytes) override {
+    if (bytes <= 0) {
+      return;
+    }
+    double sample = absl::ToDoubleNanoseconds(elapsed_time) / bytes;
+    absl::Time now = absl::Now();
+    {
+      absl::MutexLock l(&slot->lock);
+      double cost = slot->cost.load(std::memory_order_relaxed);
+      if (sample > cost) {
+        cost = sample;
+      } else {
+        absl::Time cost_time = absl::FromUnixNanos(
+            slot->cost_time_ns.load(std::memory_order_relaxed));
+        double w = std::exp(-absl::ToDoubleSeconds(now - cost_time) /
+                            absl::ToDoubleSeconds(kDecayTime));
+        cost = cost * w + sample * (1 - w);
+      }
+      slot->cost.store(cost, std::memory_order_relaxed);
+      slot->cost_time_ns.store(absl::ToUnixNanos(now),
+                               std::memory_order_relaxed);
+    }
+    UpdateMeanCost();
+  }
+
+ private:
+  // Lets an idle channel which used to be slow be picked again over time.
+  static double Decay(double cost, absl::Duration idle_time) {
+    return cost * std::exp(-absl::ToDoubleSeconds(idle_time) /
+                           absl::ToDoubleSeconds(kDecayTime));
+  }
+
+  void UpdateMeanCost() {
+    double sum = 0;
+    int count = 0;
+    for (const auto& slot : slots_) {
+      double cost = slot.cost.load(std::memory_order_relaxed);
+      if (cost > 0) {
+        sum += cost;
+        count += 1;
+      }
+    }
+    mean_cost_.store(count > 0 ? sum / count : 0, std::memory_order_relaxed);
+  }
+
+  static constexpr absl::Duration kDecayTime = absl::Seconds(10);
+
+  std::atomic<double> mean_cost_{0};
+};
+
+std::shared_ptr<StorageStubProvider> CreatePeakEwmaChannelPool(
+    std::function<std::shared_ptr<grpc::Channel>()> channel_creator, int size,
+    std::shared_ptr<RunnerWatcher> watcher) {
+  return std::make_shared<PeakEwmaChannelPool>(channel_creator, size, watcher);
+}
+
+// Starts with one channel and adds one when calls in flight per channel go
+// beyond the target, up to the max size. Least used channels are picked,
+// lower ones first on a tie, so spare channels stay idle when demand drops
+// and get closed after the idle timeout.
+class ElasticChannelPool : public StorageStubProvider {
+ public:
+  ElasticChannelPool(
+      std::function<std::shared_ptr<grpc::Channel>()> channel_creator,
+      int max_size, int target_in_flight, absl::Duration idle_timeout,
+      std::shared_ptr<RunnerWatcher> watcher)
+      : channel_creator_(channel_creator),
+        max_size_(max_size),
+        target_in_flight_(target_in_flight),
+        idle_timeout_(idle_timeout),
+        watcher_(watcher),
+        replacer_(channel_creator, watcher) {
+    absl::MutexLock l(&lock_);
+    AddChannel("start");
+  }
+
+  StorageStubProvider::StubHolder GetStorageStub() override {
+    absl::MutexLock l(&lock_);
+    absl::Time now = absl::Now();
+    RemoveIdleChannels(now);
+
+    if (channel_states_.size() < size_t(max_size_) &&
+        in_flight_count_ + 1 >
+            int64_t(target_in_flight_) * channel_states_.size()) {
+      AddChannel("grow");
+    }
+
+    auto least = channel_states_.begin();
+    for (auto i = channel_states_.begin(); i != channel_states_.end(); ++i) {
+      if (std::make_pair(i->channel->IsFailing(), i->in_use_count) <
+          std::make_pair(least->channel->IsFailing(), least->in_use_count)) {
+        least = i;
+      }
+    }
+    least->in_use_count += 1;
+    least->last_used_time = now;
+    in_flight_count_ += 1;
+    return least->channel->ToStubHolder();
+  }
+
+  void ReportResult(void* handle, const grpc::Status& status,
+                    const grpc::ClientContext& context,
+                    absl::Duration elapsed_time, int64_t bytes) override {
+    absl::MutexLock l(&lock_);
+    absl::Time now = absl::Now();
+    in_flight_count_ -= 1;
+    auto i = FindState(handle);
+    if (i != channel_states_.end()) {
+      i->in_use_count -= 1;
+      i->last_used_time = now;
+      if ((status.error_code() == grpc::StatusCode::CANCELLED ||
+           status.error_code() == grpc::StatusCode::DEADLINE_EXCEEDED) &&
+          replacer_.Start(handle, *i->channel,
+                          absl::StrFormat("peer=%s error=%d", context.peer(),
+                                          status.error_code()),
+                          [this, handle](std::shared_ptr<grpc::Channel> c) {
+                            return SwapChannel(handle, std::move(c));
+                          })) {
+        std::cerr << "Evict the channel (peer=" << context.peer()
+                  << ") due to error:" << status.error_code() << std::endl;
+      }
+    }
+    RemoveIdleChannels(now);
+  }
+
+ private:
+  void AddChannel(const char* reason) ABSL_EXCLUSIVE_LOCKS_REQUIRED(lock_) {
+    channel_states_.push_back(ChannelState{
+        std::make_shared<PooledChannel>(channel_creator_()), 0, absl::Now()});
+    watcher_->NotifyEvent("pool_size", channel_states_.size(), reason);
+  }
+
+  struct ChannelState {
+    std::shared_ptr<const PooledChannel> channel;
+    int32_t in_use_count;
+    absl::Time last_used_time;
+  };
+
+  std::vector<ChannelState>::iterator FindState(void* handle)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(lock_) {
+    return std::find_if(channel_states_.begin(), channel_states_.end(),
+                        [handle](const ChannelState& val) {
+                          return (void*)val.channel->channel.get() == handle;
+                        });
+  }
+
+  // Puts the channel in place of the one having the handle unless it has
+  // been closed meanwhile.
+  int64_t SwapChannel(void* handle, std::shared_ptr<grpc::Channel> channel) {
+    absl::MutexLock l(&lock_);
+    auto i = FindState(handle);
+    if (i == channel_states_.end()) {
+      return 0;
+    }
+    // Calls still in flight on the old channel report its handle, which is
+    // no longer found, so they must not be counted on the new one.
+    i->channel = std::make_shared<PooledChannel>(std::move(channel));
+    i->in_use_count = 0;
+    return i->channel->id;
+  }
+
+  // Closes channels which have had no call for the idle timeout, keeping
+  // at least one.
+  void RemoveIdleChannels(absl::Time now)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(lock_) {
+    for (size_t i = channel_states_.size(); i-- > 0;) {
+      if (channel_states_.size() <= 1) {
+        break;
+      }
+      const ChannelState& state = channel_states_[i];
+      if (state.in_use_count <= 0 &&
+          now - state.last_used_time > idle_timeout_) {
+        channel_states_.erase(channel_states_.begin() + i);
+        watcher_->NotifyEvent("pool_size", channel_states_.size(), "shrink");
+      }
+    }
+  }
+
+ private:
+  absl::Mutex lock_;
+  std::function<std::shared_ptr<grpc::Channel>()> channel_creator_;
+  int max_size_;
+  int target_in_flight_;
+  absl::Duration idle_timeout_;
+  std::shared_ptr<RunnerWatcher> watcher_;
+  std::vector<ChannelState> channel_states_ ABSL_GUARDED_BY(lock_);
+  int64_t in_flight_count_ ABSL_GUARDED_BY(lock_) = 0;
+  // Declared last so that replacements in progress finish first.
+  ChannelReplacer replacer_;
+};
+
+std::shared_ptr<StorageStubProvider> CreateElasticChannelPool(
+    std::function<std::shared_ptr<grpc::Channel>()> channel_creator,
+    int max_size, int target_in_flight, absl::Duration idle_timeout,
+    std::shared_ptr<RunnerWatcher> watcher) {
+  return std::make_shared<ElasticChannelPool>(
+      channel_creator, max_size, target_in_flight, idle_timeout, watcher);
+}
+
+class SmartRoundRobinChannelPool : public StorageStubProvider {
+ public:
+  SmartRoundRobinChannelPool(
+      std::function<std::shared_ptr<grpc::Channel>()> channel_creator,
+      int size, ChannelScorerOptions scorer_options,
+      std::shared_ptr<RunnerWatcher> watcher)
+      : channels_(channel_creator, size, watcher),
+        score_board_(scorer_options),
+        watcher_(watcher) {}
+
+  StorageStubProvider::StubHolder GetStorageStub() override {
+    size_t cursor = cursor_.fetch_add(1, std::memory_order_relaxed);
+    return channels_.Pick(cursor)->ToStubHolder();
+  }
+
   void ReportResult(void* handle, const grpc::Status& status,
                     const grpc::ClientContext& context,
                     absl::Duration elapsed_time, int64_t bytes) override {
@@ -241,14 +867,11 @@ class SmartRoundRobinChannelPool : public StorageStubProvider {
     if (!status.ok()) {
       if (status.error_code() == grpc::CANCELLED ||
           status.error_code() == grpc::DEADLINE_EXCEEDED) {
-        auto i = std::find_if(channels_.begin(), channels_.end(),
-                              [handle](std::shared_ptr<grpc::Channel> val) {
-                                return (void*)val.get() == handle;
-                              });
-        if (i != channels_.end()) {
+        if (channels_.Evict(handle, absl::StrFormat("peer=%s error=%d",
+                                                    context.peer(),
+                                                    status.error_code()))) {
           std::cout << "Evict the channel (peer=" << context.peer()
                     << ") due to error:" << status.error_code() << std::endl;
-          *i = channel_creator_();
         }
         return;
       } else {
@@ -256,92 +879,130 @@ class SmartRoundRobinChannelPool : public StorageStubProvider {
       }
     }
 
-    // Update the state of the corresponding channel.
-    auto iter = channep_state_map_.find(handle);
-    if (iter != channep_state_map_.end()) {
-      iter->second.count += 1;
-      iter->second.total_bytes += bytes;
-      iter->second.total_time += elapsed_time;
-      iter->second.peer = context.peer();
-    }
+    // Update the score of the corresponding channel.
+    absl::Time now = absl::Now();
+    score_board_.Add(handle, context.peer(), now, bytes, elapsed_time);
 
     // once the update counter exceeds the threadhold, it evaluates
     // the last performer to be evicted.
-    score_count += 1;
-    if (score_count > (int)channep_state_map_.size() * 3) {
-      void* least_key = 0;
-      int valid_count = 0;
-      int64_t least_score = 0xffffffffffffl;
-      std::string least_peer;
-      int64_t best_score = 0;
-      for (auto s : channep_state_map_) {
-        if (s.second.count == 0) {
-          continue;
-        }
-        valid_count += 1;
-        int64_t score = s.second.total_bytes /
-                        absl::ToInt64Milliseconds(s.second.total_time);
-        if (score < least_score) {
-          least_key = s.first;
-          least_score = score;
-          least_peer = s.second.peer;
-        }
-        if (score > best_score) {
-          best_score = score;
-        }
+    auto channels = channels_.GetSnapshot();
+    score_count_ += 1;
+    if (score_count_ > int(channels->size()) * 3) {
+      score_count_ = 0;
+      std::unordered_set<void*> live_keys;
+      for (const auto& c : *channels) {
+        live_keys.insert((void*)c->channel.get());
       }
-
-      if (valid_count < int(channep_state_map_.size()) / 2) {
-        std::cerr << "No quorum: " << valid_count << " of "
-                  << channep_state_map_.size() / 2 << std::endl;
-      } else if (least_score >= best_score / 3) {
-        std::cerr << "No least to evict: least_score " << least_score
-                  << ", best_score: " << best_score << std::endl;
-        score_count = 0;
-        InitChannelStateMap();
-      } else {
-        auto i = std::find_if(channels_.begin(), channels_.end(),
-                              [least_key](std::shared_ptr<grpc::Channel> val) {
-                                return (void*)val.get() == least_key;
-                              });
-        if (i != channels_.end()) {
-          std::cout << "Evict the channel (peer=" << least_peer
-                    << ") because it underperformed score: " << least_score
-                    << ", best_score: " << best_score << std::endl;
-          *i = channel_creator_();
-        }
-        score_count = 0;
-        InitChannelStateMap();
+      auto decision = score_board_.Evaluate(now, live_keys);
+      if (decision.evict) {
+        watcher_->NotifyEvent(
+            "evict_decision", 1,
+            absl::StrFormat("reason=%s peer=%s score=%.3f best_score=%.3f "
+                            "ratio=%.3f scored=%d",
+                            decision.reason, decision.peer, decision.score,
+                            decision.best_score,
+                            score_board_.options().evict_ratio,
+                            decision.scored_count));
+      }
+      if (decision.evict &&
+          channels_.Evict(decision.key,
+                          absl::StrFormat("peer=%s score=%.3f best_score=%.3f",
+                                          decision.peer, decision.score,
+                                          decision.best_score))) {
+        std::cout << "Evict the channel (peer=" << decision.peer
+                  << ") because it underperformed score: " << decision.score
+                  << ", best_score: " << decision.best_score << std::endl;
       }
     }
   }
 
  private:
-  void InitChannelStateMap() {
-    channep_state_map_.clear();
-    for (auto c : channels_) {
-      channep_state_map_[(void*)c.get()] =
-          ChannelState{0, 0, absl::Duration(), ""};
+  absl::Mutex lock_;
+  ChannelList channels_;
+  std::atomic<size_t> cursor_{0};
+  ChannelScoreBoard score_board_ ABSL_GUARDED_BY(lock_);
+  std::shared_ptr<RunnerWatcher> watcher_;
+  int score_count_ ABSL_GUARDED_BY(lock_) = 0;
+};
+
+std::shared_ptr<StorageStubProvider> CreateSmartRoundRobinChannelPool(
+    std::function<std::shared_ptr<grpc::Channel>()> channel_creator, int size,
+    ChannelScorerOptions scorer_options,
+    std::shared_ptr<RunnerWatcher> watcher) {
+  return std::make_shared<SmartRoundRobinChannelPool>(
+      channel_creator, size, scorer_options, watcher);
+}
+
+class TrafficClassStubProvider : public StorageStubProvider {
+ public:
+  TrafficClassStubProvider(
+      std::shared_ptr<StorageStubProvider> latency_partition,
+      std::shared_ptr<StorageStubProvider> bulk_partition,
+      bool latency_borrows, bool bulk_borrows,
+      std::shared_ptr<PartitionLoad> load)
+      : load_(std::move(load)) {
+    partitions_[kLatency].provider = std::move(latency_partition);
+    partitions_[kLatency].can_borrow = latency_borrows;
+    partitions_[kLatency].in_flight = &load_->latency;
+    partitions_[kBulk].provider = std::move(bulk_partition);
+    partitions_[kBulk].can_borrow = bulk_borrows;
+    partitions_[kBulk].in_flight = &load_->bulk;
+  }
+
+  StorageStubProvider::StubHolder GetStorageStub() override {
+    return GetStorageStubForClass(TrafficClass::kBulk);
+  }
+
+  StorageStubProvider::StubHolder GetStorageStubForClass(
+      TrafficClass traffic_class) override {
+    int own = traffic_class == TrafficClass::kLatency ? kLatency : kBulk;
+    int other = 1 - own;
+    int index = own;
+    if (partitions_[own].can_borrow &&
+        partitions_[own].in_flight->load() > 0 &&
+        partitions_[other].in_flight->load() == 0) {
+      index = other;
     }
+    Partition& partition = partitions_[index];
+    *partition.in_flight += 1;
+    auto holder = partition.provider->GetStorageStub();
+    // Handles of partitions point to objects so their lowest bit is free to
+    // carry the partition index back in ReportResult.
+    holder.handle = (void*)((uintptr_t)holder.handle | index);
+    holder.partition =
+        index == kLatency ? TrafficClass::kLatency : TrafficClass::kBulk;
+    return holder;
   }
 
- private:
-  absl::Mutex lock_;
-  std::function<std::shared_ptr<grpc::Channel>()> channel_creator_;
-  std::vector<std::shared_ptr<grpc::Channel>> channels_;
-  int cursor_ = 0;
+  void ReportResult(void* handle, const grpc::Status& status,
+                    const grpc::ClientContext& context,
+                    absl::Duration elapsed_time, int64_t bytes) override {
+    int index = (int)((uintptr_t)handle & 1);
+    Partition& partition = partitions_[index];
+    *partition.in_flight -= 1;
+    partition.provider->ReportResult((void*)((uintptr_t)handle & ~uintptr_t(1)),
+                                     status, context, elapsed_time, bytes);
+  }
 
-  struct ChannelState {
-    int count;
-    int64_t total_bytes;
-    absl::Duration total_time;
-    std::string peer;
+ private:
+  static constexpr int kBulk = 0;
+  static constexpr int kLatency = 1;
+
+  struct Partition {
+    std::shared_ptr<StorageStubProvider> provider;
+    bool can_borrow = false;
+    // Points into load_
+    std::atomic<int>* in_flight = nullptr;
   };
-  std::unordered_map<void*, ChannelState> channep_state_map_;
-  int score_count = 0;
+
+  std::shared_ptr<PartitionLoad> load_;
+  Partition partitions_[2];
 };
 
-std::shared_ptr<StorageStubProvider> CreateSmartRoundRobinChannelPool(
-    std::function<std::shared_ptr<grpc::Channel>()> channel_creator, int size) {
-  return std::make_shared<SmartRoundRobinChannelPool>(channel_creator, size);
+std::shared_ptr<StorageStubProvider> CreateTrafficClassStubProvider(
+    std::shared_ptr<StorageStubProvider> latency_partition,
+    std::shared_ptr<StorageStubProvider> bulk_partition, bool latency_borrows,
+    bool bulk_borrows, std::shared_ptr<PartitionLoad> load) {
+  return std::make_shared<TrafficClassStubProvider>(
+      latency_partition, bulk_partition, latency_borrows, bulk_borrows, load);
 }
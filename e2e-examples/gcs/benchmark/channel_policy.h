@@ -17,17 +17,35 @@
 
 #include <grpcpp/channel.h>
 
+#include <atomic>
 #include <memory>
 
 #include "absl/strings/string_view.h"
 #include "absl/time/time.h"
+#include "channel_scorer.h"
 #include "google/storage/v2/storage.grpc.pb.h"
+#include "runner_watcher.h"
+
+// Class of traffic a call belongs to. Latency calls are small ones which
+// should not queue up behind bulk transfers on the same channel.
+enum class TrafficClass { kBulk, kLatency };
+
+const char* ToString(TrafficClass traffic_class);
+
+// Returns the channel which the channel being created on this thread
+// replaces after an eviction, or null if it's not a replacement. Channel
+// creators use it to keep the replacement on the backend of the old one.
+const grpc::Channel* GetReplacedChannel();
 
 class StorageStubProvider {
  public:
   struct StubHolder {
-    std::unique_ptr<google::storage::v2::Storage::Stub> stub;
+    std::shared_ptr<google::storage::v2::Storage::Stub> stub;
     void* handle;
+    int64_t channel_id;
+    // Partition which served the call. Differs from the class asked for
+    // when the call borrowed a channel of another partition.
+    TrafficClass partition = TrafficClass::kBulk;
   };
 
  public:
@@ -36,27 +54,80 @@ class StorageStubProvider {
   // Returns a stub holder holding
   // - stub for calling the RPC
   // - handle for reporing the result
+  // - id of the channel which stays the same while the channel is in use
   virtual StubHolder GetStorageStub() = 0;
 
+  // Returns a stub holder for a call of the given traffic class. Providers
+  // not partitioned by class serve all classes alike.
+  virtual StubHolder GetStorageStubForClass(TrafficClass /*traffic_class*/) {
+    return GetStorageStub();
+  }
+
   // Reports result
   virtual void ReportResult(void* handle, const grpc::Status& status,
                             const grpc::ClientContext& context,
                             absl::Duration elapsed_time, int64_t bytes) = 0;
 };
 
+// Channel swaps after evictions of this and the pools below are reported to
+// the watcher as evict_swap events.
 std::shared_ptr<StorageStubProvider> CreateConstChannelPool(
-    std::function<std::shared_ptr<grpc::Channel>()> channel_creator);
+    std::function<std::shared_ptr<grpc::Channel>()> channel_creator,
+    std::shared_ptr<RunnerWatcher> watcher);
 
+// Setup times of channels created for every call are reported to the
+// watcher.
 std::shared_ptr<StorageStubProvider> CreateCreateNewChannelStubProvider(
-    std::function<std::shared_ptr<grpc::Channel>()> channel_creator);
+    std::function<std::shared_ptr<grpc::Channel>()> channel_creator,
+    std::shared_ptr<RunnerWatcher> watcher);
 
+// Evictions of the round-robin pools are reported to the watcher.
 std::shared_ptr<StorageStubProvider> CreateRoundRobinChannelPool(
-    std::function<std::shared_ptr<grpc::Channel>()> channel_creator, int size);
+    std::function<std::shared_ptr<grpc::Channel>()> channel_creator, int size,
+    std::shared_ptr<RunnerWatcher> watcher);
 
 std::shared_ptr<StorageStubProvider> CreateRoundRobinPlusChannelPool(
-    std::function<std::shared_ptr<grpc::Channel>()> channel_creator, int size);
+    std::function<std::shared_ptr<grpc::Channel>()> channel_creator, int size,
+    std::shared_ptr<RunnerWatcher> watcher);
+
+std::shared_ptr<StorageStubProvider> CreatePowerOfTwoChoicesChannelPool(
+    std::function<std::shared_ptr<grpc::Channel>()> channel_creator, int size,
+    std::shared_ptr<RunnerWatcher> watcher);
 
+std::shared_ptr<StorageStubProvider> CreatePeakEwmaChannelPool(
+    std::function<std::shared_ptr<grpc::Channel>()> channel_creator, int size,
+    std::shared_ptr<RunnerWatcher> watcher);
+
+// Creates a pool which grows up to max_size channels to keep calls in flight
+// per channel under target_in_flight and closes channels idle for
+// idle_timeout. Pool size changes are reported to the watcher.
+std::shared_ptr<StorageStubProvider> CreateElasticChannelPool(
+    std::function<std::shared_ptr<grpc::Channel>()> channel_creator,
+    int max_size, int target_in_flight, absl::Duration idle_timeout,
+    std::shared_ptr<RunnerWatcher> watcher);
+
+// Creates a round-robin pool evicting channels which score low. Each
+// evaluation is reported to the watcher as an evict_decision event.
 std::shared_ptr<StorageStubProvider> CreateSmartRoundRobinChannelPool(
-    std::function<std::shared_ptr<grpc::Channel>()> channel_creator, int size);
+    std::function<std::shared_ptr<grpc::Channel>()> channel_creator, int size,
+    ChannelScorerOptions scorer_options,
+    std::shared_ptr<RunnerWatcher> watcher);
+
+// Calls in flight on the partition of each traffic class. Providers of all
+// threads share one so that borrowing sees the calls of every thread rather
+// than the ones of its own thread, which has none in flight when it picks.
+struct PartitionLoad {
+  std::atomic<int> latency{0};
+  std::atomic<int> bulk{0};
+};
+
+// Creates a provider which keeps a partition of channels for each traffic
+// class. A class borrows the partition of the other class only if allowed
+// and only when the other partition has no call in flight while its own
+// partition has, as counted by the given load.
+std::shared_ptr<StorageStubProvider> CreateTrafficClassStubProvider(
+    std::shared_ptr<StorageStubProvider> latency_partition,
+    std::shared_ptr<StorageStubProvider> bulk_partition, bool latency_borrows,
+    bool bulk_borrows, std::shared_ptr<PartitionLoad> load);
 
 #endif  // GCS_BENCHMARK_CHANNEL_POLICY_H_
@@ -16,50 +16,89 @@
 
 #include <chrono>
 
-ChannelPoller::ChannelPoller(std::shared_ptr<grpc::Channel> channel)
-    : channel_(channel) {
-  StartWatch();
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+
+// Watches expire and get re-armed at this interval so that a watch of an
+// unwatched channel ends even if the channel is still used elsewhere.
+static constexpr absl::Duration kWatchInterval = absl::Seconds(1);
+
+ChannelPoller::ChannelPoller() {
   thread_ = std::unique_ptr<std::thread>(
       new std::thread([this]() { this->ThreadRun(); }));
 }
 
 ChannelPoller::~ChannelPoller() {
   {
-    std::shared_ptr<grpc::Channel> tmp_channel;
-    {
-      absl::MutexLock lock(&mu_);
-      tmp_channel.swap(channel_);
-    }
+    absl::MutexLock lock(&mu_);
     // Give ChannelPoller a chance to handle remaining events
-    // while shutting down the channel.
-    tmp_channel.reset();
-    {
-      absl::MutexLock lock(&mu_);
-      shutdown_ = true;
-      cq_.Shutdown();
+    // while shutting down the channels.
+    for (auto& w : watchers_) {
+      w.second->channel.reset();
+      w.second->callback = nullptr;
     }
+    watchers_.clear();
+    shutdown_ = true;
+    cq_.Shutdown();
   }
   thread_->join();
 }
 
-void ChannelPoller::StartWatch() {
-  if (channel_ != nullptr) {
-    grpc_connectivity_state last_observed = channel_->GetState(false);
-    channel_->NotifyOnStateChange(last_observed,
-                                  std::chrono::system_clock::time_point::max(),
-                                  &cq_, nullptr);
+ChannelPoller* ChannelPoller::Default() {
+  static ChannelPoller* poller = new ChannelPoller();
+  return poller;
+}
+
+int64_t ChannelPoller::Watch(std::shared_ptr<grpc::Channel> channel,
+                             Callback callback) {
+  absl::MutexLock lock(&mu_);
+  auto watcher = new Watcher{channel, callback, channel->GetState(false)};
+  watcher->callback(watcher->last_state);
+  int64_t id = next_id_++;
+  watchers_[id] = watcher;
+  StartWatch(watcher);
+  return id;
+}
+
+void ChannelPoller::Unwatch(int64_t id) {
+  absl::MutexLock lock(&mu_);
+  auto i = watchers_.find(id);
+  if (i == watchers_.end()) {
+    return;
   }
+  // The pending notification finishes by the watch interval at the latest
+  // and then the watcher gets deleted.
+  i->second->channel.reset();
+  i->second->callback = nullptr;
+  watchers_.erase(i);
+}
+
+void ChannelPoller::StartWatch(Watcher* watcher) {
+  watcher->channel->NotifyOnStateChange(
+      watcher->last_state, absl::ToChronoTime(absl::Now() + kWatchInterval),
+      &cq_, watcher);
 }
 
 void ChannelPoller::ThreadRun() {
-  // Keep calling Next in order to poll a channel.
+  // Keep calling Next in order to poll channels.
   bool ok = false;
   void* tag = nullptr;
   while (cq_.Next(&tag, &ok)) {
     absl::MutexLock lock(&mu_);
+    auto watcher = static_cast<Watcher*>(tag);
+    if (watcher->channel == nullptr) {
+      delete watcher;
+      continue;
+    }
     if (shutdown_) {
-      break;
+      continue;
+    }
+    // Notifications also come when the watch expires without a change.
+    grpc_connectivity_state state = watcher->channel->GetState(false);
+    if (state != watcher->last_state) {
+      watcher->last_state = state;
+      watcher->callback(state);
     }
-    StartWatch();
+    StartWatch(watcher);
   }
 }
@@ -17,26 +17,52 @@
 
 #include <grpcpp/channel.h>
 
+#include <functional>
 #include <memory>
 #include <thread>
+#include <unordered_map>
 
 #include "absl/synchronization/mutex.h"
 
+// Watches connectivity states of many channels on a single completion queue
+// and thread, which also keeps the channels polled.
 class ChannelPoller {
  public:
-  ChannelPoller(std::shared_ptr<grpc::Channel> channel);
+  // Called on the poller thread with its lock held so it should be quick.
+  using Callback = std::function<void(grpc_connectivity_state)>;
+
+  ChannelPoller();
   ~ChannelPoller();
 
+  // Returns the poller shared by all channel pools.
+  static ChannelPoller* Default();
+
+  // Starts watching the channel and returns the id for Unwatch. The callback
+  // gets the current state first and then every new state.
+  int64_t Watch(std::shared_ptr<grpc::Channel> channel, Callback callback);
+
+  // Stops watching. The callback won't be called after this returns.
+  void Unwatch(int64_t id);
+
  private:
-  void StartWatch();
+  struct Watcher {
+    std::shared_ptr<grpc::Channel> channel;
+    Callback callback;
+    grpc_connectivity_state last_state;
+  };
+
+  void StartWatch(Watcher* watcher) ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
   void ThreadRun();
 
  private:
-  std::shared_ptr<grpc::Channel> channel_;
   grpc::CompletionQueue cq_;
   std::unique_ptr<std::thread> thread_;
   absl::Mutex mu_;
-  bool shutdown_ = false;
+  bool shutdown_ ABSL_GUARDED_BY(mu_) = false;
+  int64_t next_id_ ABSL_GUARDED_BY(mu_) = 1;
+  // Watchers are owned by the map until unwatched and then deleted when their
+  // last notification comes back from the queue.
+  std::unordered_map<int64_t, Watcher*> watchers_ ABSL_GUARDED_BY(mu_);
 };
 
 #endif  // GCS_BENCHMARK_CHANNEL_POLLER_H_
@@ -0,0 +1,132 @@
+// Copyright 2026 gRPC authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "channel_prober.h"
+
+#include <grpcpp/client_context.h>
+
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <thread>
+#include <unordered_set>
+
+#include "absl/time/clock.h"
+#include "src/proto/grpc/health/v1/health.grpc.pb.h"
+
+namespace {
+
+constexpr absl::Duration kProbeTimeout = absl::Seconds(10);
+
+// Probes all channels at the same time.
+std::vector<ProbedChannel> ProbeChannels(
+    std::vector<std::shared_ptr<grpc::Channel>> channels) {
+  std::vector<ProbedChannel> probed(channels.size());
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < channels.size(); i++) {
+    probed[i].channel = channels[i];
+    threads.emplace_back([&probed, i]() {
+      probed[i].peer = ProbePeer(probed[i].channel, kProbeTimeout);
+    });
+  }
+  std::for_each(threads.begin(), threads.end(),
+                [](std::thread& t) { t.join(); });
+  return probed;
+}
+
+}  // namespace
+
+std::string ProbePeer(const std::shared_ptr<grpc::Channel>& channel,
+                      absl::Duration timeout) {
+  grpc::health::v1::HealthCheckRequest request;
+  request.set_service("google.storage.v1.Storage");
+  grpc::health::v1::HealthCheckResponse response;
+  grpc::ClientContext context;
+  if (timeout != absl::InfiniteDuration()) {
+    context.set_deadline(absl::ToChronoTime(absl::Now() + timeout));
+  }
+  auto stub = grpc::health::v1::Health::NewStub(channel);
+  // The status doesn't matter since any response tells the peer.
+  stub->Check(&context, request, &response);
+  return context.peer();
+}
+
+std::vector<ProbedChannel> CreatePeerDiverseChannels(
+    std::function<std::shared_ptr<grpc::Channel>()> channel_creator, int size,
+    int retries) {
+  std::vector<ProbedChannel> distinct;
+  std::vector<ProbedChannel> duplicates;
+  std::unordered_set<std::string> peers;
+  int to_create = size;
+  while (to_create > 0) {
+    std::vector<std::shared_ptr<grpc::Channel>> channels;
+    for (int i = 0; i < to_create; i++) {
+      channels.push_back(channel_creator());
+    }
+    for (auto& c : ProbeChannels(std::move(channels))) {
+      if (!c.peer.empty() && peers.insert(c.peer).second) {
+        distinct.push_back(std::move(c));
+      } else {
+        duplicates.push_back(std::move(c));
+      }
+    }
+    // Duplicates are kept until the end so that new channels are less likely
+    // to be given the same connection by the server side.
+    int missing = size - int(distinct.size());
+    to_create = std::min(missing, retries);
+    retries -= to_create;
+  }
+  for (auto& c : duplicates) {
+    if (int(distinct.size()) >= size) {
+      break;
+    }
+    distinct.push_back(std::move(c));
+  }
+  return distinct;
+}
+
+bool ConnectChannels(
+    const std::vector<std::shared_ptr<grpc::Channel>>& channels,
+    absl::Duration timeout, int retries, std::vector<ProbedChannel>* probed) {
+  probed->clear();
+  probed->resize(channels.size());
+  std::atomic<bool> all_ready(true);
+  std::vector<std::thread> threads;
+  absl::Time start = absl::Now();
+  for (size_t i = 0; i < channels.size(); i++) {
+    threads.emplace_back([&, i]() {
+      ProbedChannel& c = (*probed)[i];
+      c.channel = channels[i];
+      for (c.attempts = 1;; c.attempts++) {
+        absl::Time attempt_start = absl::Now();
+        c.channel->GetState(true);
+        if (c.channel->WaitForConnected(
+                absl::ToChronoTime(attempt_start + timeout))) {
+          c.connect_time = absl::Now() - start;
+          c.peer = ProbePeer(c.channel, timeout);
+          return;
+        }
+        std::cerr << "Channel " << i << " didn't get ready in " << timeout
+                  << " (attempt " << c.attempts << ")" << std::endl;
+        if (c.attempts > retries) {
+          all_ready = false;
+          return;
+        }
+      }
+    });
+  }
+  std::for_each(threads.begin(), threads.end(),
+                [](std::thread& t) { t.join(); });
+  return all_ready;
+}
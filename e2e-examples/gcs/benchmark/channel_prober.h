@@ -0,0 +1,56 @@
+// Copyright 2026 gRPC authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef GCS_BENCHMARK_CHANNEL_PROBER_H_
+#define GCS_BENCHMARK_CHANNEL_PROBER_H_
+
+#include <grpcpp/channel.h>
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/time/time.h"
+
+// Makes a health-check call on the channel to get it connected and returns
+// the peer the call went to. Returns an empty string if it didn't reach any.
+std::string ProbePeer(const std::shared_ptr<grpc::Channel>& channel,
+                      absl::Duration timeout = absl::InfiniteDuration());
+
+struct ProbedChannel {
+  std::shared_ptr<grpc::Channel> channel;
+  std::string peer;
+  // Time taken for the channel to get ready. Only set by ConnectChannels.
+  absl::Duration connect_time;
+  int attempts = 1;
+};
+
+// Creates channels connected to as many distinct peers as possible.
+// Channels landing on a peer which is already taken are recreated until
+// there are `size` distinct peers or `retries` more channels have been
+// created. If it runs out of retries, channels with duplicate peers fill
+// the rest so that it always returns `size` channels.
+std::vector<ProbedChannel> CreatePeerDiverseChannels(
+    std::function<std::shared_ptr<grpc::Channel>()> channel_creator, int size,
+    int retries);
+
+// Connects the channels all at the same time. Channels not getting ready
+// within the timeout are waited on up to `retries` more times while gRPC
+// keeps reconnecting them. Returns false if any of them never gets ready.
+bool ConnectChannels(
+    const std::vector<std::shared_ptr<grpc::Channel>>& channels,
+    absl::Duration timeout, int retries, std::vector<ProbedChannel>* probed);
+
+#endif  // GCS_BENCHMARK_CHANNEL_PROBER_H_
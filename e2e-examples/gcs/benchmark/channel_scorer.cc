@@ -0,0 +1,201 @@
+// Copyright 2026 gRPC authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "channel_scorer.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "absl/memory/memory.h"
+
+class ChannelScoreBoard::Scorer {
+ public:
+  virtual ~Scorer() = default;
+  virtual void Add(absl::Time time, double value) = 0;
+  // Returns the mean of samples which still count at the given time.
+  virtual double GetMean(absl::Time now) = 0;
+  virtual int GetCount(absl::Time now) = 0;
+};
+
+// Weighs all samples since the channel joined equally and never drops them,
+// unlike the old pool which started over every 3 * size reports.
+class ChannelScoreBoard::CumulativeScorer : public ChannelScoreBoard::Scorer {
+ public:
+  void Add(absl::Time /*time*/, double value) override {
+    sum_ += value;
+    count_ += 1;
+  }
+  double GetMean(absl::Time /*now*/) override {
+    return count_ == 0 ? 0 : sum_ / count_;
+  }
+  int GetCount(absl::Time /*now*/) override { return count_; }
+
+ private:
+  double sum_ = 0;
+  int count_ = 0;
+};
+
+// Only counts samples taken within the window.
+class ChannelScoreBoard::WindowScorer : public ChannelScoreBoard::Scorer {
+ public:
+  explicit WindowScorer(absl::Duration window) : window_(window) {}
+
+  void Add(absl::Time time, double value) override {
+    samples_.push_back({time, value});
+    sum_ += value;
+  }
+  double GetMean(absl::Time now) override {
+    Expire(now);
+    return samples_.empty() ? 0 : sum_ / samples_.size();
+  }
+  int GetCount(absl::Time now) override {
+    Expire(now);
+    return samples_.size();
+  }
+
+ private:
+  void Expire(absl::Time now) {
+    while (!samples_.empty() && samples_.front().first < now - window_) {
+      sum_ -= samples_.front().second;
+      samples_.pop_front();
+    }
+    if (samples_.empty()) {
+      sum_ = 0;
+    }
+  }
+
+  absl::Duration window_;
+  std::deque<std::pair<absl::Time, double>> samples_;
+  double sum_ = 0;
+};
+
+// Weighs samples down exponentially by their age.
+class ChannelScoreBoard::DecayScorer : public ChannelScoreBoard::Scorer {
+ public:
+  explicit DecayScorer(absl::Duration half_life) : half_life_(half_life) {}
+
+  void Add(absl::Time time, double value) override {
+    Decay(time);
+    sum_ += value;
+    weight_ += 1;
+    count_ += 1;
+  }
+  double GetMean(absl::Time now) override {
+    Decay(now);
+    return weight_ == 0 ? 0 : sum_ / weight_;
+  }
+  // Counts all samples since old ones still weigh a little.
+  int GetCount(absl::Time /*now*/) override { return count_; }
+
+ private:
+  void Decay(absl::Time now) {
+    if (now > last_time_) {
+      double w = std::exp2(-absl::FDivDuration(now - last_time_, half_life_));
+      sum_ *= w;
+      weight_ *= w;
+      last_time_ = now;
+    }
+  }
+
+  absl::Duration half_life_;
+  absl::Time last_time_ = absl::InfinitePast();
+  double sum_ = 0;
+  double weight_ = 0;
+  int count_ = 0;
+};
+
+bool IsValidChannelScorerType(const std::string& type) {
+  return type == "cumulative" || type == "window" || type == "decay";
+}
+
+ChannelScoreBoard::ChannelScoreBoard(ChannelScorerOptions options)
+    : options_(options) {}
+
+ChannelScoreBoard::~ChannelScoreBoard() = default;
+
+std::unique_ptr<ChannelScoreBoard::Scorer> ChannelScoreBoard::CreateScorer()
+    const {
+  if (options_.type == "cumulative") {
+    return absl::make_unique<CumulativeScorer>();
+  } else if (options_.type == "window") {
+    return absl::make_unique<WindowScorer>(options_.window);
+  }
+  return absl::make_unique<DecayScorer>(options_.half_life);
+}
+
+int ChannelScoreBoard::GetSizeClass(int64_t bytes) {
+  // Classes grow by 4x from 64KiB; smaller ones are all in the first class.
+  int size_class = 0;
+  for (int64_t limit = 64 * 1024; bytes >= limit; limit *= 4) {
+    size_class += 1;
+  }
+  return size_class;
+}
+
+void ChannelScoreBoard::Add(void* key, const std::string& peer,
+                            absl::Time time, int64_t bytes,
+                            absl::Duration elapsed_time) {
+  // Avoids dividing by zero for operations faster than the clock.
+  double throughput =
+      bytes / std::max(absl::ToDoubleSeconds(elapsed_time), 1e-6);
+  auto& size_class_scorer = size_class_scorers_[GetSizeClass(bytes)];
+  if (size_class_scorer == nullptr) {
+    size_class_scorer = CreateScorer();
+  }
+  size_class_scorer->Add(time, throughput);
+  double baseline = size_class_scorer->GetMean(time);
+
+  auto& score = scores_[key];
+  if (score.scorer == nullptr) {
+    score.scorer = CreateScorer();
+  }
+  score.peer = peer;
+  score.scorer->Add(time, baseline > 0 ? throughput / baseline : 1);
+}
+
+ChannelScoreBoard::Decision ChannelScoreBoard::Evaluate(
+    absl::Time now, const std::unordered_set<void*>& live_keys) {
+  Decision decision;
+  double least_score = HUGE_VAL;
+  for (auto i = scores_.begin(); i != scores_.end();) {
+    if (live_keys.count(i->first) == 0) {
+      i = scores_.erase(i);
+      continue;
+    }
+    if (i->second.scorer->GetCount(now) >= options_.min_samples) {
+      double score = i->second.scorer->GetMean(now);
+      decision.scored_count += 1;
+      if (score < least_score) {
+        least_score = score;
+        decision.key = i->first;
+        decision.peer = i->second.peer;
+      }
+      decision.best_score = std::max(decision.best_score, score);
+    }
+    ++i;
+  }
+  decision.score = decision.scored_count > 0 ? least_score : 0;
+
+  if (decision.scored_count < int(live_keys.size()) / 2) {
+    decision.reason = "no_quorum";
+  } else if (decision.score >= decision.best_score * options_.evict_ratio) {
+    decision.reason = "within_ratio";
+  } else {
+    decision.evict = true;
+    decision.reason = "underperformed";
+    // The replacement starts over.
+    scores_.erase(decision.key);
+  }
+  return decision;
+}
@@ -0,0 +1,90 @@
+// Copyright 2026 gRPC authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef GCS_BENCHMARK_CHANNEL_SCORER_H_
+#define GCS_BENCHMARK_CHANNEL_SCORER_H_
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "absl/time/time.h"
+
+struct ChannelScorerOptions {
+  // How samples are combined (cumulative, window, decay)
+  std::string type = "decay";
+  // Samples older than this are dropped by the window scorer
+  absl::Duration window = absl::Seconds(10);
+  // Weight of a sample halves every half-life for the decay scorer
+  absl::Duration half_life = absl::Seconds(10);
+  // Channels with fewer samples than this are not scored
+  int min_samples = 3;
+  // Channel scoring below this ratio of the best score gets evicted
+  double evict_ratio = 1.0 / 3;
+};
+
+bool IsValidChannelScorerType(const std::string& type);
+
+// Scores channels by their throughput. Each sample is divided by the recent
+// throughput of all channels for operations of the same size class so that
+// channels serving more small operations are not taken as slow ones.
+class ChannelScoreBoard {
+ public:
+  struct Decision {
+    bool evict = false;
+    void* key = nullptr;
+    std::string peer;
+    double score = 0;
+    double best_score = 0;
+    int scored_count = 0;
+    std::string reason;
+  };
+
+ public:
+  explicit ChannelScoreBoard(ChannelScorerOptions options);
+  ~ChannelScoreBoard();
+
+  void Add(void* key, const std::string& peer, absl::Time time, int64_t bytes,
+           absl::Duration elapsed_time);
+
+  // Finds the worst channel among the given live ones and decides whether it
+  // should be evicted. Channels not in live_keys are forgotten.
+  Decision Evaluate(absl::Time now, const std::unordered_set<void*>& live_keys);
+
+  const ChannelScorerOptions& options() const { return options_; }
+
+ private:
+  class Scorer;
+  class CumulativeScorer;
+  class WindowScorer;
+  class DecayScorer;
+
+  struct ChannelScore {
+    std::unique_ptr<Scorer> scorer;
+    std::string peer;
+  };
+
+  std::unique_ptr<Scorer> CreateScorer() const;
+  static int GetSizeClass(int64_t bytes);
+
+ private:
+  ChannelScorerOptions options_;
+  std::unordered_map<void*, ChannelScore> scores_;
+  // Throughput of each size class across all channels
+  std::unordered_map<int, std::unique_ptr<Scorer>> size_class_scorers_;
+};
+
+#endif  // GCS_BENCHMARK_CHANNEL_SCORER_H_
@@ -0,0 +1,146 @@
+// Copyright 2026 gRPC authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "concurrency_controller.h"
+
+#include <algorithm>
+
+#include "absl/strings/str_format.h"
+#include "absl/time/clock.h"
+
+namespace {
+
+constexpr double kMB = 1024.0 * 1024.0;
+
+// A window needs at least this many operations to be judged.
+constexpr size_t kMinWindowCount = 4;
+
+// Throughput should improve by this ratio to keep increasing concurrency.
+constexpr double kMinGain = 0.05;
+
+// Latency is considered to be worse when p99 goes beyond this times of
+// the lowest p99 seen so far.
+constexpr double kLatencyFactor = 2.0;
+
+}  // namespace
+
+ConcurrencyController::ConcurrencyController(
+    int max_concurrency, int initial_concurrency, absl::Duration window,
+    std::shared_ptr<RunnerWatcher> watcher)
+    : max_concurrency_(max_concurrency), window_(window), watcher_(watcher) {
+  concurrency_ = std::max(1, std::min(initial_concurrency, max_concurrency));
+  best_concurrency_ = concurrency_;
+  window_start_ = absl::Now();
+  watcher_->NotifyEvent("concurrency", concurrency_, "start");
+  thread_ = std::unique_ptr<std::thread>(
+      new std::thread([this]() { this->ThreadRun(); }));
+}
+
+ConcurrencyController::~ConcurrencyController() {
+  Stop();
+  thread_->join();
+}
+
+void ConcurrencyController::WaitForTurn(int worker_id) {
+  absl::MutexLock l(&mu_);
+  auto turn = [this, worker_id]() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    return stopped_ || worker_id <= concurrency_;
+  };
+  mu_.Await(absl::Condition(&turn));
+}
+
+void ConcurrencyController::Report(int64_t bytes,
+                                   absl::Duration elapsed_time) {
+  absl::MutexLock l(&mu_);
+  window_bytes_ += bytes;
+  window_latencies_.push_back(elapsed_time);
+}
+
+void ConcurrencyController::Stop() {
+  absl::MutexLock l(&mu_);
+  if (stopped_) {
+    return;
+  }
+  stopped_ = true;
+  if (!settled_) {
+    Settle();
+  }
+}
+
+void ConcurrencyController::ThreadRun() {
+  absl::MutexLock l(&mu_);
+  while (!mu_.AwaitWithTimeout(absl::Condition(&stopped_), window_)) {
+    if (!settled_) {
+      Adjust(absl::Now());
+    }
+  }
+}
+
+void ConcurrencyController::Adjust(absl::Time now) {
+  // Keeps the window open until it gets enough samples.
+  if (window_latencies_.size() < kMinWindowCount) {
+    return;
+  }
+  double throughput =
+      window_bytes_ / absl::ToDoubleSeconds(now - window_start_);
+  std::sort(window_latencies_.begin(), window_latencies_.end());
+  absl::Duration p99_latency =
+      window_latencies_[size_t(0.99 * window_latencies_.size())];
+  watcher_->NotifyEvent(
+      "concurrency", concurrency_,
+      absl::StrFormat("count=%d throughput=%.2fMB/s p99=%.3fs",
+                      window_latencies_.size(), throughput / kMB,
+                      absl::ToDoubleSeconds(p99_latency)));
+  window_start_ = now;
+  window_bytes_ = 0;
+  window_latencies_.clear();
+
+  bool latency_worse = p99_latency > min_p99_latency_ * kLatencyFactor;
+  min_p99_latency_ = std::min(min_p99_latency_, p99_latency);
+  if (!latency_worse && throughput > best_throughput_ * (1 + kMinGain)) {
+    best_concurrency_ = concurrency_;
+    best_throughput_ = throughput;
+    best_throughput_p99_latency_ = p99_latency;
+    if (concurrency_ >= max_concurrency_) {
+      Settle();
+    } else if (slow_start_) {
+      concurrency_ = std::min(max_concurrency_, concurrency_ * 2);
+    } else {
+      concurrency_ =
+          std::min(max_concurrency_,
+                   concurrency_ + std::max(1, best_concurrency_ / 4));
+    }
+  } else if (slow_start_ && best_concurrency_ < max_concurrency_) {
+    // Goes back to the best point and probes above it more carefully
+    // unless there is no room between the best and the current one.
+    slow_start_ = false;
+    int next = best_concurrency_ + std::max(1, best_concurrency_ / 4);
+    if (next >= concurrency_) {
+      Settle();
+    } else {
+      concurrency_ = next;
+    }
+  } else {
+    Settle();
+  }
+}
+
+void ConcurrencyController::Settle() {
+  settled_ = true;
+  concurrency_ = best_concurrency_;
+  watcher_->NotifyEvent(
+      "concurrency_chosen", concurrency_,
+      absl::StrFormat("throughput=%.2fMB/s p99=%.3fs", best_throughput_ / kMB,
+                      absl::ToDoubleSeconds(best_throughput_p99_latency_)));
+}
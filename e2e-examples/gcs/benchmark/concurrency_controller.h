@@ -0,0 +1,75 @@
+// Copyright 2026 gRPC authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef GCS_BENCHMARK_CONCURRENCY_CONTROLLER_H_
+#define GCS_BENCHMARK_CONCURRENCY_CONTROLLER_H_
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "runner_watcher.h"
+
+// Finds the saturation point of a run by changing the number of active
+// workers online. Every window it looks at the throughput and the p99 latency
+// of operations completed in that window. Concurrency doubles while
+// throughput keeps improving (slow start) and then grows additively from the
+// best point found. Once throughput stops improving or p99 latency gets much
+// worse than the best seen so far, it settles at the best concurrency, which
+// is the knee of the curve. Every step is recorded as an event of the watcher.
+class ConcurrencyController {
+ public:
+  ConcurrencyController(int max_concurrency, int initial_concurrency,
+                        absl::Duration window,
+                        std::shared_ptr<RunnerWatcher> watcher);
+  ~ConcurrencyController();
+
+  // Blocks the worker (1-based) until it's allowed to run an operation.
+  void WaitForTurn(int worker_id);
+
+  // Reports a completed operation.
+  void Report(int64_t bytes, absl::Duration elapsed_time);
+
+  // Releases all blocked workers and stops adjusting concurrency.
+  void Stop();
+
+ private:
+  void ThreadRun();
+  void Adjust(absl::Time now) ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  void Settle() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+ private:
+  const int max_concurrency_;
+  const absl::Duration window_;
+  std::shared_ptr<RunnerWatcher> watcher_;
+  std::unique_ptr<std::thread> thread_;
+
+  absl::Mutex mu_;
+  int concurrency_ ABSL_GUARDED_BY(mu_);
+  bool slow_start_ ABSL_GUARDED_BY(mu_) = true;
+  bool settled_ ABSL_GUARDED_BY(mu_) = false;
+  bool stopped_ ABSL_GUARDED_BY(mu_) = false;
+  absl::Time window_start_ ABSL_GUARDED_BY(mu_);
+  int64_t window_bytes_ ABSL_GUARDED_BY(mu_) = 0;
+  std::vector<absl::Duration> window_latencies_ ABSL_GUARDED_BY(mu_);
+  int best_concurrency_ ABSL_GUARDED_BY(mu_);
+  double best_throughput_ ABSL_GUARDED_BY(mu_) = 0;
+  absl::Duration best_throughput_p99_latency_ ABSL_GUARDED_BY(mu_);
+  absl::Duration min_p99_latency_ ABSL_GUARDED_BY(mu_) =
+      absl::InfiniteDuration();
+};
+
+#endif  // GCS_BENCHMARK_CONCURRENCY_CONTROLLER_H_
@@ -20,6 +20,7 @@
 #include "absl/random/random.h"
 #include "absl/strings/cord.h"
 #include "absl/time/time.h"
+#include "channel_args_profile.h"
 #include "e2e-examples/gcs/benchmark/random_data.h"
 #include "google/cloud/grpc_options.h"
 #include "google/cloud/storage/client.h"
@@ -30,7 +31,10 @@ GcscppRunner::GcscppRunner(Parameters parameters,
     : parameters_(parameters),
       object_resolver_(parameters_.object, parameters_.object_format,
                        parameters_.object_start, parameters_.object_stop),
-      watcher_(watcher) {}
+      watcher_(watcher),
+      global_bandwidth_limiter_(
+          CreateRateLimiter(parameters_.global_bandwidth_limit)),
+      global_ops_limiter_(CreateRateLimiter(parameters_.global_ops_limit)) {}
 
 static google::cloud::storage::Client CreateClient(
     const Parameters& parameters) {
@@ -55,9 +59,12 @@ static google::cloud::storage::Client CreateClient(
     if (parameters.carg != 0) {
       opts.set<google::cloud::GrpcNumChannelsOption>(parameters.carg);
     }
-    if (parameters.tx_zerocopy) {
+    if (parameters.tx_zerocopy || !parameters.channel_args.args.empty()) {
       grpc::ChannelArguments channel_arguments;
-      channel_arguments.SetInt(GRPC_ARG_TCP_TX_ZEROCOPY_ENABLED, 1);
+      if (parameters.tx_zerocopy) {
+        channel_arguments.SetInt(GRPC_ARG_TCP_TX_ZEROCOPY_ENABLED, 1);
+      }
+      ApplyChannelArgsProfile(parameters.channel_args, &channel_arguments);
       opts.set<google::cloud::GrpcChannelArgumentsNativeOption>(
           channel_arguments);
     }
@@ -122,9 +129,12 @@ std::string ExtractPeer(
 
 bool GcscppRunner::DoRead(int thread_id,
                           google::cloud::storage::Client storage_client) {
+  Throttler throttler(parameters_.bandwidth_limit, parameters_.ops_limit,
+                      global_bandwidth_limiter_, global_ops_limiter_);
   std::vector<char> buffer(4 * 1024 * 1024);
   auto const buffer_size = static_cast<std::streamsize>(buffer.size());
   for (int run = 0; run < parameters_.runs; run++) {
+    absl::Duration throttled_time = throttler.AcquireOperation();
     std::string object = object_resolver_.Resolve(thread_id, run);
 
     absl::Time run_start = absl::Now();
@@ -142,6 +152,7 @@ bool GcscppRunner::DoRead(int thread_id,
       RunnerWatcher::Chunk chunk = {absl::Now(), content_size};
       chunks.push_back(chunk);
       total_bytes += content_size;
+      throttled_time += throttler.AcquireBytes(content_size);
     }
     reader.Close();
     absl::Time run_end = absl::Now();
@@ -149,7 +160,7 @@ bool GcscppRunner::DoRead(int thread_id,
     watcher_->NotifyCompleted(OperationType::Read, thread_id, 0,
                               ExtractPeer(reader.headers()), parameters_.bucket,
                               object, grpc::Status::OK, total_bytes, run_start,
-                              run_end - run_start, chunks);
+                              run_end - run_start, throttled_time, chunks);
   }
   return true;
 }
@@ -178,10 +189,13 @@ bool GcscppRunner::DoRandomRead(int thread_id,
     return false;
   }
 
+  Throttler throttler(parameters_.bandwidth_limit, parameters_.ops_limit,
+                      global_bandwidth_limiter_, global_ops_limiter_);
   std::string object = object_resolver_.Resolve(thread_id, 0);
   absl::BitGen gen;
   std::vector<char> buffer(4 * 1024 * 1024);
   for (int run = 0; run < parameters_.runs; run++) {
+    absl::Duration throttled_time = throttler.AcquireOperation();
     int64_t offset = absl::Uniform(gen, 0, chunks) * parameters_.chunk_size;
     absl::Time run_start = absl::Now();
     auto reader =
@@ -202,6 +216,7 @@ bool GcscppRunner::DoRandomRead(int thread_id,
       RunnerWatcher::Chunk chunk = {absl::Now(), content_size};
       chunks.push_back(chunk);
       total_bytes += content_size;
+      throttled_time += throttler.AcquireBytes(content_size);
     }
     reader.Close();
     absl::Time run_end = absl::Now();
@@ -209,7 +224,7 @@ bool GcscppRunner::DoRandomRead(int thread_id,
     watcher_->NotifyCompleted(OperationType::Read, thread_id, 0,
                               ExtractPeer(reader.headers()), parameters_.bucket,
                               object, grpc::Status::OK, total_bytes, run_start,
-                              run_end - run_start, chunks);
+                              run_end - run_start, throttled_time, chunks);
   }
 
   return true;
@@ -220,7 +235,8 @@ bool GcscppRunner::DoWrite(int thread_id,
   const int64_t max_chunk_size = (parameters_.chunk_size < 0)
                                      ? parameters_.write_size
                                      : parameters_.chunk_size;
-  absl::Cord content = GetRandomData(max_chunk_size);
+  absl::Cord content =
+      GetCompressibleData(max_chunk_size, parameters_.write_compression_ratio);
   absl::string_view content_data = content.Flatten();
 
   if (parameters_.object_stop > 0) {
@@ -232,7 +248,10 @@ bool GcscppRunner::DoWrite(int thread_id,
     return false;
   }
 
+  Throttler throttler(parameters_.bandwidth_limit, parameters_.ops_limit,
+                      global_bandwidth_limiter_, global_ops_limiter_);
   for (int run = 0; run < parameters_.runs; run++) {
+    absl::Duration throttled_time = throttler.AcquireOperation();
     std::string object = object_resolver_.Resolve(thread_id, run);
     absl::Time run_start = absl::Now();
 
@@ -248,6 +267,7 @@ bool GcscppRunner::DoWrite(int thread_id,
 
     for (int64_t o = 0; o < parameters_.write_size; o += max_chunk_size) {
       int64_t chunk_size = std::min(max_chunk_size, parameters_.write_size - o);
+      throttled_time += throttler.AcquireBytes(chunk_size);
       writer.write(content_data.data(), chunk_size);
 
       RunnerWatcher::Chunk chunk = {absl::Now(), chunk_size};
@@ -260,7 +280,8 @@ bool GcscppRunner::DoWrite(int thread_id,
     watcher_->NotifyCompleted(OperationType::Write, thread_id, 0,
                               ExtractPeer(writer.headers()), parameters_.bucket,
                               object, grpc::Status::OK, total_bytes, run_start,
-                              run_end - run_start, std::move(chunks));
+                              run_end - run_start, throttled_time,
+                              std::move(chunks));
   }
 
   return true;
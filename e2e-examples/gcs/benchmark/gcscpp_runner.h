@@ -21,6 +21,7 @@
 #include "google/cloud/storage/client.h"
 #include "object_resolver.h"
 #include "parameters.h"
+#include "rate_limiter.h"
 #include "runner.h"
 #include "runner_watcher.h"
 
@@ -41,6 +42,8 @@ class GcscppRunner : public Runner {
   Parameters parameters_;
   ObjectResolver object_resolver_;
   std::shared_ptr<RunnerWatcher> watcher_;
+  std::shared_ptr<RateLimiter> global_bandwidth_limiter_;
+  std::shared_ptr<RateLimiter> global_ops_limiter_;
 };
 
 #endif  // GCS_BENCHMARK_GCSCPP_RUNNER_H_
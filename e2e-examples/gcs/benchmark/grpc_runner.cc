@@ -20,24 +20,46 @@
 #include <grpcpp/create_channel.h>
 #include <grpcpp/grpcpp.h>
 #include <grpcpp/security/credentials.h>
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netdb.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
 #include <stdlib.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
 
+#include <algorithm>
 #include <functional>
+#include <limits>
 #include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
 
 #include "absl/crc/crc32c.h"
+#include "absl/memory/memory.h"
 #include "absl/random/random.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/str_replace.h"
 #include "absl/strings/string_view.h"
+#include "absl/strings/strip.h"
+#include "absl/synchronization/mutex.h"
 #include "absl/time/clock.h"
 #include "absl/time/time.h"
+#include "backend_list.h"
 #include "channel_creator.h"
 #include "channel_policy.h"
+#include "channel_prober.h"
+#include "grpc_threads.h"
 #include "e2e-examples/gcs/benchmark/random_data.h"
 #include "google/storage/v2/storage.grpc.pb.h"
+#include "net_stats.h"
 
+using ::google::storage::v2::GetObjectRequest;
 using ::google::storage::v2::Object;
 using ::google::storage::v2::ReadObjectRequest;
 using ::google::storage::v2::ReadObjectResponse;
@@ -55,26 +77,29 @@ extern int run_mtest(
     const Parameters& parameters);
 
 static std::shared_ptr<grpc::Channel> CreateBenchmarkGrpcChannel(
-    const Parameters& parameters) {
-  return CreateGrpcChannel(parameters.host, parameters.access_token,
+    const Parameters& parameters, absl::string_view host) {
+  return CreateGrpcChannel(host, parameters.access_token,
                            parameters.network, parameters.cred,
-                           parameters.ssl_cert, parameters.rr, parameters.td,
-                           parameters.tx_zerocopy);
+                           parameters.ssl_cert, parameters.rr, parameters.wrr,
+                           parameters.td, parameters.tx_zerocopy,
+                           parameters.cache_credentials,
+                           parameters.ssl_session_cache,
+                           parameters.compression, parameters.channel_args);
 }
 
-static int32_t GetChannelId(void* stub_handle) {
-  static std::unordered_map<void*, int32_t> handle_to_id_map;
-  static absl::Mutex lock;
-
-  absl::MutexLock l(&lock);
-  auto i = handle_to_id_map.find(stub_handle);
-  if (i != handle_to_id_map.end()) {
-    return i->second;
+// Pins the current thread to cpus [first_cpu, first_cpu + cpu_count).
+static void PinCurrentThread(int first_cpu, int cpu_count) {
+#ifdef __linux__
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  for (int cpu = first_cpu; cpu < first_cpu + cpu_count; cpu++) {
+    CPU_SET(cpu, &cpu_set);
   }
-
-  auto new_id = int32_t(handle_to_id_map.size() + 1);
-  handle_to_id_map[stub_handle] = new_id;
-  return new_id;
+  if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) != 0) {
+    std::cerr << "Failed to pin the thread to cpus " << first_cpu << "-"
+              << first_cpu + cpu_count - 1 << std::endl;
+  }
+#endif
 }
 
 static std::string ToV2BucketName(absl::string_view bucket_name) {
@@ -97,6 +122,220 @@ static void ApplyCallTimeout(grpc::ClientContext* context,
   }
 }
 
+static void ApplyCallCompression(grpc::ClientContext* context,
+                                 absl::string_view compression) {
+  grpc_compression_algorithm algorithm;
+  if (ParseCompressionAlgorithm(compression, &algorithm)) {
+    context->set_compression_algorithm(algorithm);
+  }
+}
+
+// Returns CPU time the process has used so far.
+static absl::Duration GetProcessCpuTime() {
+  struct rusage ru;
+  if (getrusage(RUSAGE_SELF, &ru) != 0) {
+    return absl::ZeroDuration();
+  }
+  return absl::DurationFromTimeval(ru.ru_utime) +
+         absl::DurationFromTimeval(ru.ru_stime);
+}
+
+// Resolves the host of the target (host:port, [ipv6]:port or host, with an
+// optional dns:, ipv4: or ipv6: scheme) and returns the first address as a
+// target which needs no further resolution.
+static bool ResolveTarget(absl::string_view target, std::string* host,
+                          std::string* resolved_target,
+                          struct sockaddr_storage* addr, socklen_t* addr_len) {
+  if (absl::ConsumePrefix(&target, "dns:")) {
+    // Drops the authority of dns://authority/host as well.
+    if (absl::ConsumePrefix(&target, "//")) {
+      size_t slash = target.find('/');
+      if (slash == absl::string_view::npos) {
+        return false;
+      }
+      target.remove_prefix(slash + 1);
+    }
+  } else if (absl::ConsumePrefix(&target, "ipv4:") ||
+             absl::ConsumePrefix(&target, "ipv6:")) {
+    // Takes the first of the listed addresses.
+    target = target.substr(0, target.find(','));
+  }
+  absl::string_view port = "443";
+  absl::string_view h = target;
+  if (!target.empty() && target.front() == '[') {
+    size_t close = target.find(']');
+    if (close == absl::string_view::npos) {
+      return false;
+    }
+    h = target.substr(1, close - 1);
+    if (close + 2 < target.size() && target[close + 1] == ':') {
+      port = target.substr(close + 2);
+    }
+  } else {
+    size_t colon = target.rfind(':');
+    if (colon != absl::string_view::npos) {
+      h = target.substr(0, colon);
+      port = target.substr(colon + 1);
+    }
+  }
+  *host = std::string(h);
+
+  struct addrinfo hints = {};
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  struct addrinfo* result = nullptr;
+  if (getaddrinfo(host->c_str(), std::string(port).c_str(), &hints,
+                  &result) != 0 ||
+      result == nullptr) {
+    return false;
+  }
+  memcpy(addr, result->ai_addr, result->ai_addrlen);
+  *addr_len = result->ai_addrlen;
+  char ip[INET6_ADDRSTRLEN] = {};
+  if (result->ai_family == AF_INET6) {
+    inet_ntop(AF_INET6, &((struct sockaddr_in6*)result->ai_addr)->sin6_addr,
+              ip, sizeof(ip));
+    *resolved_target = absl::StrCat("ipv6:[", ip, "]:", port);
+  } else {
+    inet_ntop(AF_INET, &((struct sockaddr_in*)result->ai_addr)->sin_addr, ip,
+              sizeof(ip));
+    *resolved_target = absl::StrCat("ipv4:", ip, ":", port);
+  }
+  freeaddrinfo(result);
+  return true;
+}
+
+// Opens a TCP connection to the address and closes it right away. Gives up
+// after the timeout.
+static bool ConnectTcp(const struct sockaddr_storage& addr, socklen_t addr_len,
+                       absl::Duration timeout) {
+  int fd = socket(addr.ss_family, SOCK_STREAM | SOCK_NONBLOCK, 0);
+  if (fd < 0) {
+    return false;
+  }
+  bool ok = connect(fd, (const struct sockaddr*)&addr, addr_len) == 0;
+  if (!ok && errno == EINPROGRESS) {
+    struct pollfd pfd = {};
+    pfd.fd = fd;
+    pfd.events = POLLOUT;
+    const int timeout_ms = static_cast<int>(std::min<int64_t>(
+        absl::ToInt64Milliseconds(timeout), std::numeric_limits<int>::max()));
+    int error = 0;
+    socklen_t error_len = sizeof(error);
+    ok = poll(&pfd, 1, timeout_ms) == 1 &&
+         getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &error_len) == 0 &&
+         error == 0;
+  }
+  close(fd);
+  return ok;
+}
+
+static ChannelScorerOptions GetChannelScorerOptions(
+    const Parameters& parameters) {
+  ChannelScorerOptions options;
+  options.type = parameters.score_type;
+  options.window = parameters.score_window;
+  options.half_life = parameters.score_half_life;
+  options.min_samples = parameters.score_min_samples;
+  options.evict_ratio = parameters.score_evict_ratio;
+  return options;
+}
+
+// Returns a channel creator which hands out the given channels first and
+// then falls back to the given creator.
+static std::function<std::shared_ptr<grpc::Channel>()> CreateChannelSupplier(
+    std::vector<std::shared_ptr<grpc::Channel>> channels,
+    std::function<std::shared_ptr<grpc::Channel>()> channel_creator) {
+  struct State {
+    absl::Mutex lock;
+    std::vector<std::shared_ptr<grpc::Channel>> channels;
+  };
+  auto state = std::make_shared<State>();
+  state->channels = std::move(channels);
+  std::reverse(state->channels.begin(), state->channels.end());
+  return [state, channel_creator]() {
+    {
+      absl::MutexLock l(&state->lock);
+      if (!state->channels.empty()) {
+        auto channel = std::move(state->channels.back());
+        state->channels.pop_back();
+        return channel;
+      }
+    }
+    return channel_creator();
+  };
+}
+
+// Channels made by a recording channel creator while it's recording.
+// Channels dropped in the meantime are not kept alive by it.
+struct RecordedChannels {
+  absl::Mutex lock;
+  bool recording ABSL_GUARDED_BY(lock) = true;
+  std::vector<std::weak_ptr<grpc::Channel>> channels ABSL_GUARDED_BY(lock);
+
+  // Stops recording and returns the recorded channels still in use.
+  std::vector<std::shared_ptr<grpc::Channel>> Stop() {
+    absl::MutexLock l(&lock);
+    recording = false;
+    std::vector<std::shared_ptr<grpc::Channel>> live;
+    for (const auto& c : channels) {
+      if (auto channel = c.lock()) {
+        live.push_back(std::move(channel));
+      }
+    }
+    channels.clear();
+    return live;
+  }
+};
+
+// Returns a channel creator which records channels made by the given one.
+static std::function<std::shared_ptr<grpc::Channel>()>
+CreateRecordingChannelCreator(
+    std::function<std::shared_ptr<grpc::Channel>()> channel_creator,
+    std::shared_ptr<RecordedChannels> recorded) {
+  return [channel_creator, recorded]() {
+    auto channel = channel_creator();
+    absl::MutexLock l(&recorded->lock);
+    if (recorded->recording) {
+      recorded->channels.push_back(channel);
+    }
+    return channel;
+  };
+}
+
+// Backends of channels created for --backends.
+struct ChannelBackends {
+  absl::Mutex lock;
+  std::unordered_map<const grpc::Channel*,
+                     std::pair<std::weak_ptr<grpc::Channel>, Backend>>
+      backends ABSL_GUARDED_BY(lock);
+  // Size of backends at which channels gone are dropped from it
+  size_t prune_size ABSL_GUARDED_BY(lock) = 64;
+
+  // Returns true with the backend of the channel if it's still alive.
+  bool Find(const grpc::Channel* channel, Backend* backend) {
+    absl::MutexLock l(&lock);
+    auto i = backends.find(channel);
+    if (i == backends.end() || i->second.first.expired()) {
+      return false;
+    }
+    *backend = i->second.second;
+    return true;
+  }
+
+  void Add(const std::shared_ptr<grpc::Channel>& channel,
+           const Backend& backend) {
+    absl::MutexLock l(&lock);
+    if (backends.size() >= prune_size) {
+      for (auto i = backends.begin(); i != backends.end();) {
+        i = i->second.first.expired() ? backends.erase(i) : std::next(i);
+      }
+      prune_size = std::max<size_t>(64, backends.size() * 2);
+    }
+    backends[channel.get()] = {channel, backend};
+  }
+};
+
 namespace {
 
 absl::crc32c_t ComputeCrc32c(const absl::Cord& cord) {
@@ -109,83 +348,437 @@ absl::crc32c_t ComputeCrc32c(const absl::Cord& cord) {
 
 }  // namespace
 
-GrpcRunner::GrpcRunner(Parameters parameters,
-                       std::shared_ptr<RunnerWatcher> watcher)
+GrpcRunner::GrpcRunner(
+    Parameters parameters, std::shared_ptr<RunnerWatcher> watcher,
+    std::function<std::shared_ptr<grpc::Channel>()> channel_creator)
     : parameters_(parameters),
+      channel_creator_(channel_creator),
       object_resolver_(parameters_.object, parameters_.object_format,
                        parameters_.object_start, parameters_.object_stop),
-      watcher_(watcher) {}
+      watcher_(watcher),
+      global_bandwidth_limiter_(
+          CreateRateLimiter(parameters_.global_bandwidth_limit)),
+      global_ops_limiter_(CreateRateLimiter(parameters_.global_ops_limit)) {}
 
 bool GrpcRunner::Run() {
-  std::function<std::shared_ptr<grpc::Channel>()> channel_creator = [&]() {
-    return CreateBenchmarkGrpcChannel(parameters_);
-  };
+  // Shards share the in-process server and the backends of their parent.
+  if (channel_creator_ == nullptr && !parameters_.backends.empty()) {
+    // Each channel gets one backend so that peers are known up front. A
+    // channel replacing an evicted one takes over its backend so that the
+    // weighted assignment holds over the run.
+    auto picker = std::make_shared<BackendPicker>(parameters_.backends);
+    auto channel_backends = std::make_shared<ChannelBackends>();
+    channel_creator_ = [this, picker, channel_backends]() {
+      Backend backend;
+      const grpc::Channel* replaced = GetReplacedChannel();
+      if (replaced == nullptr || !channel_backends->Find(replaced, &backend)) {
+        backend = picker->Next();
+      }
+      auto channel =
+          CreateBenchmarkGrpcChannel(parameters_, GetBackendTarget(backend));
+      channel_backends->Add(channel, backend);
+      return channel;
+    };
+  }
+  if (channel_creator_ == nullptr && parameters_.network == "inproc") {
+    inproc_server_ = InProcessServer::Start();
+    if (inproc_server_ == nullptr) {
+      std::cerr << "Failed to start the in-process server." << std::endl;
+      return false;
+    }
+    channel_creator_ = [this]() {
+      return inproc_server_->CreateChannel(parameters_.channel_args);
+    };
+  }
+  std::function<std::shared_ptr<grpc::Channel>()> channel_creator =
+      channel_creator_;
+  if (channel_creator == nullptr) {
+    channel_creator = [&]() {
+      return CreateBenchmarkGrpcChannel(parameters_, parameters_.host);
+    };
+  }
   if (parameters_.ctest > 0) {
     return run_ctest(channel_creator, parameters_);
   }
   if (parameters_.mtest > 0) {
     return run_mtest(channel_creator, parameters_);
   }
+  if (parameters_.shards > 0) {
+    return RunShards();
+  }
+  // Prewarm connects the channels pools and threads are set up with, which
+  // get recorded until the threads are about to start.
+  auto recorded = std::make_shared<RecordedChannels>();
+  if (parameters_.prewarm) {
+    channel_creator = CreateRecordingChannelCreator(channel_creator, recorded);
+  }
 
-  // Initializes a gRPC channel pool.
+  // Initializes a gRPC channel pool and another one for the latency class
+  // if it gets its own partition. Connect operations make their own channels.
   std::shared_ptr<StorageStubProvider> stub_pool;
-  if (parameters_.cpolicy == "const") {
-    stub_pool = CreateConstChannelPool(channel_creator);
-  } else if (parameters_.cpolicy == "pool") {
-    if (parameters_.carg <= 0) {
-      std::cerr << "Invalid carg: " << parameters_.carg << std::endl;
-      return false;
-    }
-    stub_pool = CreateRoundRobinChannelPool(channel_creator, parameters_.carg);
-  } else if (parameters_.cpolicy == "bpool") {
-    if (parameters_.carg <= 0) {
-      std::cerr << "Invalid carg: " << parameters_.carg << std::endl;
-      return false;
-    }
-    stub_pool =
-        CreateRoundRobinPlusChannelPool(channel_creator, parameters_.carg);
-  } else if (parameters_.cpolicy == "spool") {
-    if (parameters_.carg <= 0) {
-      std::cerr << "Invalid carg: " << parameters_.carg << std::endl;
-      return false;
+  if (parameters_.operation_type != OperationType::Connect &&
+      !CreateStubPool(channel_creator, parameters_.carg, &stub_pool)) {
+    return false;
+  }
+  std::shared_ptr<StorageStubProvider> latency_stub_pool;
+  if (parameters_.latency_carg > 0 &&
+      !CreateStubPool(channel_creator, parameters_.latency_carg,
+                      &latency_stub_pool)) {
+    return false;
+  }
+
+  // Partitions of traffic classes count calls in flight across all threads
+  // so that borrowing sees the load of the run. Shared pools get a single
+  // provider for all threads, and channels of each thread or call get one
+  // provider per thread over the shared counts.
+  auto partition_load = std::make_shared<PartitionLoad>();
+  std::shared_ptr<StorageStubProvider> shared_class_provider;
+  if (parameters_.latency_carg > 0 && stub_pool != nullptr &&
+      latency_stub_pool != nullptr) {
+    shared_class_provider = CreateTrafficClassStubProvider(
+        latency_stub_pool, stub_pool, parameters_.class_borrow != "none",
+        parameters_.class_borrow == "both", partition_load);
+  }
+  std::vector<std::shared_ptr<StorageStubProvider>> thread_stub_providers(
+      parameters_.threads);
+  for (int i = 0; parameters_.operation_type != OperationType::Connect &&
+                  i < parameters_.threads;
+       i++) {
+    std::shared_ptr<StorageStubProvider> storage_stub_provider;
+    if (shared_class_provider != nullptr) {
+      storage_stub_provider = shared_class_provider;
+    } else if (parameters_.latency_carg > 0) {
+      storage_stub_provider = CreateTrafficClassStubProvider(
+          GetThreadStubProvider(channel_creator, latency_stub_pool),
+          GetThreadStubProvider(channel_creator, stub_pool),
+          parameters_.class_borrow != "none",
+          parameters_.class_borrow == "both", partition_load);
+    } else {
+      storage_stub_provider = GetThreadStubProvider(channel_creator, stub_pool);
     }
-    stub_pool =
-        CreateSmartRoundRobinChannelPool(channel_creator, parameters_.carg);
+    thread_stub_providers[i] = std::move(storage_stub_provider);
+  }
+  if (parameters_.prewarm && !PrewarmChannels(recorded->Stop())) {
+    return false;
   }
 
   // Spawns benchmark threads and waits until they're done.
+  const absl::Duration cpu_start = GetProcessCpuTime();
+  const bool is_shard = work_queue_ != nullptr;
+  NetStats net_start;
+  const bool has_net_stats = ReadNetStats(&net_start);
   std::vector<std::thread> threads;
   std::vector<bool> returns(parameters_.threads);
-  work_queue_.reset(new WorkQueue(parameters_.threads, parameters_.runs,
-                                  parameters_.steal_work));
-  for (int i = 1; i <= parameters_.threads; i++) {
-    int thread_id = i;
-    std::shared_ptr<StorageStubProvider> storage_stub_provider;
-    if (stub_pool != nullptr) {
-      storage_stub_provider = stub_pool;
-    } else if (parameters_.cpolicy == "perthread") {
-      storage_stub_provider = CreateConstChannelPool(channel_creator);
-    } else if (parameters_.cpolicy == "percall") {
-      storage_stub_provider =
-          CreateCreateNewChannelStubProvider(channel_creator);
-    }
-    threads.emplace_back([thread_id, storage_stub_provider, &returns, this]() {
+  // Adaptive concurrency needs work stealing so that active threads can
+  // take over works of threads that are held back.
+  // Shards get their work queue linked to others from the parent runner.
+  if (work_queue_ == nullptr) {
+    work_queue_.reset(new WorkQueue(
+        parameters_.threads, parameters_.runs,
+        parameters_.steal_work || parameters_.adaptive_concurrency));
+  }
+  if (parameters_.adaptive_concurrency) {
+    concurrency_controller_.reset(new ConcurrencyController(
+        parameters_.threads, parameters_.adaptive_start,
+        parameters_.adaptive_window, watcher_));
+  }
+  for (int i = 0; i < parameters_.threads; i++) {
+    int thread_id = first_thread_id_ + i;
+    std::shared_ptr<StorageStubProvider> storage_stub_provider =
+        thread_stub_providers[i];
+    threads.emplace_back([i, thread_id, storage_stub_provider, &returns,
+                          this]() {
+      if (shard_cpu_count_ > 0) {
+        PinCurrentThread(shard_first_cpu_, shard_cpu_count_);
+      } else {
+        PinBenchmarkThread(parameters_);
+      }
       bool r = this->DoOperation(thread_id, storage_stub_provider);
       if (!r && !parameters_.wait_threads) {
         std::cerr << "Thread id=" << thread_id << " stopped." << std::endl;
         exit(1);
       }
-      returns[thread_id - 1] = r;
+      returns[i] = r;
     });
   }
   std::for_each(threads.begin(), threads.end(),
                 [](std::thread& t) { t.join(); });
+  if (parameters_.operation_type == OperationType::Connect) {
+    // Handshakes run on threads of gRPC so the CPU time of the whole process
+    // is divided by the number of connections.
+    absl::Duration cpu_time = GetProcessCpuTime() - cpu_start;
+    size_t connections = watcher_->GetChannelSetups().size();
+    if (connections > 0) {
+      watcher_->NotifyEvent(
+          "cpu_per_connection",
+          absl::ToInt64Microseconds(cpu_time / connections),
+          absl::StrFormat("unit=us connections=%d cpu=%.2fs "
+                          "ssl_session_cache=%d",
+                          connections, absl::ToDoubleSeconds(cpu_time),
+                          parameters_.ssl_session_cache));
+    }
+  } else if (!is_shard) {
+    // CPU time per byte tells the cost of the transport apart from its
+    // speed. The in-process server of inproc runs shares the process CPU
+    // time, which is labeled so that it's not compared with tcp and uds
+    // runs as is.
+    absl::Duration cpu_time = GetProcessCpuTime() - cpu_start;
+    int64_t bytes = watcher_->GetTotalBytes();
+    NetStats net_end;
+    if (bytes > 0) {
+      watcher_->NotifyEvent(
+          "cpu_per_mib", absl::ToInt64Microseconds(cpu_time * 1048576 / bytes),
+          absl::StrFormat("unit=us network=%s bytes=%d cpu=%.2fs server=%s",
+                          parameters_.network, bytes,
+                          absl::ToDoubleSeconds(cpu_time),
+                          inproc_server_ != nullptr ? "included"
+                                                    : "excluded"));
+    }
+    if (bytes > 0 && has_net_stats && ReadNetStats(&net_end)) {
+      // Wire bytes are counted in the direction data flows and include
+      // protocol overhead, so the ratio shows what compression saves. They
+      // are totals of the network namespace, not of the calls of this run,
+      // which the detail says.
+      int64_t sent = net_end.out_octets - net_start.out_octets;
+      int64_t received = net_end.in_octets - net_start.in_octets;
+      int64_t wire_bytes =
+          parameters_.operation_type == OperationType::Write ? sent
+                                                             : received;
+      const double cpu_per_gb = absl::ToDoubleSeconds(cpu_time) * 1e9 / bytes;
+      const std::string& compression = parameters_.call_compression.empty()
+                                            ? parameters_.compression
+                                            : parameters_.call_compression;
+      watcher_->NotifyEvent(
+          "wire_bytes", wire_bytes,
+          absl::StrFormat("scope=namespace logical=%d ratio=%.3f sent=%d "
+                          "received=%d cpu_per_gb=%.3fs compression=%s",
+                          bytes, static_cast<double>(wire_bytes) / bytes, sent,
+                          received, cpu_per_gb, compression));
+    }
+  }
+  concurrency_controller_.reset();
+  work_queue_.reset();
   return std::all_of(returns.begin(), returns.end(), [](bool v) { return v; });
 }
 
+// Creates the channel pool shared by threads. Leaves it null for the
+// policies creating channels for each thread or call.
+bool GrpcRunner::CreateStubPool(
+    std::function<std::shared_ptr<grpc::Channel>()> channel_creator, int carg,
+    std::shared_ptr<StorageStubProvider>* stub_pool) {
+  if (parameters_.cpolicy == "const") {
+    *stub_pool = CreateConstChannelPool(channel_creator, watcher_);
+  } else if (parameters_.cpolicy == "pool") {
+    if (carg <= 0) {
+      std::cerr << "Invalid carg: " << carg << std::endl;
+      return false;
+    }
+    *stub_pool = CreateRoundRobinChannelPool(channel_creator, carg, watcher_);
+  } else if (parameters_.cpolicy == "bpool") {
+    if (carg <= 0) {
+      std::cerr << "Invalid carg: " << carg << std::endl;
+      return false;
+    }
+    *stub_pool =
+        CreateRoundRobinPlusChannelPool(channel_creator, carg, watcher_);
+  } else if (parameters_.cpolicy == "p2c") {
+    if (carg <= 0) {
+      std::cerr << "Invalid carg: " << carg << std::endl;
+      return false;
+    }
+    *stub_pool =
+        CreatePowerOfTwoChoicesChannelPool(channel_creator, carg, watcher_);
+  } else if (parameters_.cpolicy == "ewma") {
+    if (carg <= 0) {
+      std::cerr << "Invalid carg: " << carg << std::endl;
+      return false;
+    }
+    *stub_pool = CreatePeakEwmaChannelPool(channel_creator, carg, watcher_);
+  } else if (parameters_.cpolicy == "dpool") {
+    if (carg <= 0) {
+      std::cerr << "Invalid carg: " << carg << std::endl;
+      return false;
+    }
+    auto probed = CreatePeerDiverseChannels(channel_creator, carg,
+                                            parameters_.peer_retries);
+    std::vector<std::shared_ptr<grpc::Channel>> channels;
+    std::unordered_set<std::string> peers;
+    for (const auto& c : probed) {
+      channels.push_back(c.channel);
+      if (!c.peer.empty()) {
+        peers.insert(c.peer);
+      }
+    }
+    std::cout << "Peer coverage: " << peers.size() << " distinct peers for "
+              << channels.size() << " channels" << std::endl;
+    watcher_->NotifyEvent("peer_coverage", peers.size(),
+                          absl::StrFormat("channels=%d", channels.size()));
+    // Channels replacing evicted ones are not checked for their peers.
+    *stub_pool = CreateRoundRobinChannelPool(
+        CreateChannelSupplier(std::move(channels), channel_creator), carg,
+        watcher_);
+  } else if (parameters_.cpolicy == "epool") {
+    if (carg <= 0) {
+      std::cerr << "Invalid carg: " << carg << std::endl;
+      return false;
+    }
+    *stub_pool = CreateElasticChannelPool(channel_creator, carg,
+                                          parameters_.epool_target,
+                                          parameters_.epool_idle_timeout,
+                                          watcher_);
+  } else if (parameters_.cpolicy == "spool") {
+    if (carg <= 0) {
+      std::cerr << "Invalid carg: " << carg << std::endl;
+      return false;
+    }
+    *stub_pool = CreateSmartRoundRobinChannelPool(
+        channel_creator, carg, GetChannelScorerOptions(parameters_), watcher_);
+  }
+  return true;
+}
+
+std::shared_ptr<StorageStubProvider> GrpcRunner::GetThreadStubProvider(
+    std::function<std::shared_ptr<grpc::Channel>()> channel_creator,
+    std::shared_ptr<StorageStubProvider> stub_pool) {
+  if (stub_pool != nullptr) {
+    return stub_pool;
+  } else if (parameters_.cpolicy == "perthread") {
+    return CreateConstChannelPool(channel_creator, watcher_);
+  } else if (parameters_.cpolicy == "percall") {
+    return CreateCreateNewChannelStubProvider(channel_creator, watcher_);
+  }
+  return nullptr;
+}
+
+// Runs threads split into shards, each of which is a runner with its own
+// channels, work queue and watcher on its own core. Shards take works of
+// others only when they run out of their own and their results are merged
+// into the watcher at the end. Rate limiters are still shared.
+bool GrpcRunner::RunShards() {
+  const int shards = parameters_.shards;
+  const int cpus = std::thread::hardware_concurrency();
+  std::vector<std::unique_ptr<GrpcRunner>> runners;
+  std::vector<std::shared_ptr<RunnerWatcher>> watchers;
+  std::vector<std::shared_ptr<WorkQueue>> work_queues;
+  int first_thread_id = 1;
+  for (int s = 0; s < shards; s++) {
+    Parameters p = parameters_;
+    p.shards = 0;
+    p.threads = parameters_.threads / shards +
+                (s < parameters_.threads % shards ? 1 : 0);
+    // Keeps 0 as is since cpolicies take it as their default.
+    p.carg = parameters_.carg > 0 ? std::max(1, parameters_.carg / shards) : 0;
+    auto watcher = std::make_shared<RunnerWatcher>(0, parameters_.verbose);
+    auto runner = absl::make_unique<GrpcRunner>(p, watcher, channel_creator_);
+    runner->first_thread_id_ = first_thread_id;
+    // Each shard gets its own range of cpus, or shares one with others when
+    // there are more shards than cpus.
+    if (cpus >= shards) {
+      runner->shard_first_cpu_ = cpus / shards * s + std::min(s, cpus % shards);
+      runner->shard_cpu_count_ = cpus / shards + (s < cpus % shards ? 1 : 0);
+    } else if (cpus > 0) {
+      runner->shard_first_cpu_ = s % cpus;
+      runner->shard_cpu_count_ = 1;
+    }
+    runner->global_bandwidth_limiter_ = global_bandwidth_limiter_;
+    runner->global_ops_limiter_ = global_ops_limiter_;
+    runner->work_queue_ = std::make_shared<WorkQueue>(
+        p.threads, p.runs, p.steal_work, first_thread_id);
+    work_queues.push_back(runner->work_queue_);
+    watchers.push_back(watcher);
+    runners.push_back(std::move(runner));
+    first_thread_id += p.threads;
+  }
+  // Each shard spills over to the next ones first.
+  for (int s = 0; parameters_.steal_work && s < shards; s++) {
+    std::vector<std::shared_ptr<WorkQueue>> neighbors;
+    for (int k = 1; k < shards; k++) {
+      neighbors.push_back(work_queues[(s + k) % shards]);
+    }
+    work_queues[s]->set_neighbors(std::move(neighbors));
+  }
+
+  std::vector<std::thread> threads;
+  std::vector<int> returns(shards);
+  for (int s = 0; s < shards; s++) {
+    threads.emplace_back(
+        [s, &runners, &returns]() { returns[s] = runners[s]->Run(); });
+  }
+  std::for_each(threads.begin(), threads.end(),
+                [](std::thread& t) { t.join(); });
+
+  for (int s = 0; s < shards; s++) {
+    watcher_->Merge(*watchers[s]);
+    watcher_->NotifyEvent(
+        "shard_operations", watchers[s]->GetNonWarmupsOperations().size(),
+        absl::StrFormat("shard=%d cpus=%d-%d threads=%d", s,
+                        runners[s]->shard_first_cpu_,
+                        runners[s]->shard_first_cpu_ +
+                            runners[s]->shard_cpu_count_ - 1,
+                        runners[s]->parameters_.threads));
+  }
+  return std::all_of(returns.begin(), returns.end(), [](int v) { return v; });
+}
+
+bool GrpcRunner::PrewarmChannels(
+    const std::vector<std::shared_ptr<grpc::Channel>>& channels) {
+  if (channels.empty()) {
+    return true;
+  }
+  absl::Time start = absl::Now();
+  std::vector<ProbedChannel> probed;
+  if (!ConnectChannels(channels, parameters_.prewarm_timeout,
+                       parameters_.prewarm_retries, &probed)) {
+    std::cerr << "Failed to get all channels ready." << std::endl;
+    return false;
+  }
+  absl::Duration max_connect_time;
+  for (const auto& c : probed) {
+    watcher_->NotifyEvent(
+        "connect", absl::ToInt64Milliseconds(c.connect_time),
+        absl::StrFormat("peer=%s attempts=%d", c.peer, c.attempts));
+    max_connect_time = std::max(max_connect_time, c.connect_time);
+  }
+  std::cout << "Prewarmed " << channels.size() << " channels in "
+            << absl::Now() - start << " (max connect " << max_connect_time
+            << ")" << std::endl;
+  return true;
+}
+
+// Tells which traffic class a call moving the given bytes belongs to. Calls
+// of unknown size are taken as bulk ones.
+TrafficClass GrpcRunner::GetTrafficClass(OperationType operation_type,
+                                         int64_t bytes) const {
+  if (parameters_.traffic_classes == "type") {
+    return operation_type == OperationType::RandomRead ? TrafficClass::kLatency
+                                                       : TrafficClass::kBulk;
+  } else if (parameters_.traffic_classes == "size") {
+    return bytes > 0 && bytes <= parameters_.latency_max_bytes
+               ? TrafficClass::kLatency
+               : TrafficClass::kBulk;
+  }
+  return TrafficClass::kBulk;
+}
+
+std::string GrpcRunner::GetTrafficClassName(TrafficClass traffic_class) const {
+  return parameters_.traffic_classes.empty() ? "" : ToString(traffic_class);
+}
+
+std::string GrpcRunner::GetPartitionName(
+    const StorageStubProvider::StubHolder& storage) const {
+  return parameters_.latency_carg > 0 ? ToString(storage.partition) : "";
+}
+
 bool GrpcRunner::DoOperation(
     int thread_id, std::shared_ptr<StorageStubProvider> storage_stub_provider) {
+  // The first threads make small random reads next to the operation to
+  // mix latency-sensitive calls into the load.
+  if (thread_id <= parameters_.latency_threads) {
+    return DoRandomRead(thread_id, storage_stub_provider);
+  }
   switch (parameters_.operation_type) {
+    case OperationType::Connect:
+      return DoConnect(thread_id);
     case OperationType::Read:
       return DoRead(thread_id, storage_stub_provider);
     case OperationType::RandomRead:
@@ -199,15 +792,28 @@ bool GrpcRunner::DoOperation(
 
 bool GrpcRunner::DoRead(
     int thread_id, std::shared_ptr<StorageStubProvider> storage_stub_provider) {
+  Throttler throttler(parameters_.bandwidth_limit, parameters_.ops_limit,
+                      global_bandwidth_limiter_, global_ops_limiter_);
+  const TrafficClass traffic_class =
+      GetTrafficClass(OperationType::Read, parameters_.read_limit);
   while (true) {
+    if (concurrency_controller_ != nullptr) {
+      concurrency_controller_->WaitForTurn(thread_id);
+    }
     auto work = work_queue_->pop(thread_id);
     auto work_tid = std::get<0>(work);
     auto work_run = std::get<1>(work);
     if (work_run == 0) {
+      // Releases held-back threads since there is nothing left for them.
+      if (concurrency_controller_ != nullptr) {
+        concurrency_controller_->Stop();
+      }
       break;
     }
     while (true) {
-      auto storage = storage_stub_provider->GetStorageStub();
+      absl::Duration throttled_time = throttler.AcquireOperation();
+      auto storage =
+          storage_stub_provider->GetStorageStubForClass(traffic_class);
 
       std::string object = object_resolver_.Resolve(work_tid, work_run);
       ReadObjectRequest request;
@@ -249,6 +855,7 @@ bool GrpcRunner::DoRead(
         RunnerWatcher::Chunk chunk = {absl::Now(), content_size};
         chunks.push_back(chunk);
         total_bytes += content_size;
+        throttled_time += throttler.AcquireBytes(content_size);
       }
 
       auto status = reader->Finish();
@@ -273,9 +880,13 @@ bool GrpcRunner::DoRead(
                                           run_end - run_start, total_bytes);
 
       watcher_->NotifyCompleted(
-          OperationType::Read, work_tid, GetChannelId(storage.handle),
+          OperationType::Read, work_tid, storage.channel_id,
           context.peer(), parameters_.bucket, object, status, total_bytes,
-          run_start, run_end - run_start, std::move(chunks));
+          run_start, run_end - run_start, throttled_time, std::move(chunks),
+          GetTrafficClassName(traffic_class), GetPartitionName(storage));
+      if (concurrency_controller_ != nullptr) {
+        concurrency_controller_->Report(total_bytes, run_end - run_start);
+      }
 
       if (status.ok()) {
         break;
@@ -315,10 +926,15 @@ bool GrpcRunner::DoRandomRead(
     return false;
   }
 
-  auto storage = storage_stub_provider->GetStorageStub();
+  Throttler throttler(parameters_.bandwidth_limit, parameters_.ops_limit,
+                      global_bandwidth_limiter_, global_ops_limiter_);
+  const TrafficClass traffic_class =
+      GetTrafficClass(OperationType::RandomRead, parameters_.chunk_size);
   std::string object = object_resolver_.Resolve(thread_id, 0);
   absl::BitGen gen;
   for (int run = 0; run < parameters_.runs; run++) {
+    absl::Duration throttled_time = throttler.AcquireOperation();
+    auto storage = storage_stub_provider->GetStorageStubForClass(traffic_class);
     int64_t offset = absl::Uniform(gen, 0, chunks) * parameters_.chunk_size;
     ReadObjectRequest request;
     request.set_bucket(ToV2BucketName(parameters_.bucket));
@@ -355,6 +971,7 @@ bool GrpcRunner::DoRandomRead(
       RunnerWatcher::Chunk chunk = {absl::Now(), content_size};
       chunks.push_back(chunk);
       total_bytes += content_size;
+      throttled_time += throttler.AcquireBytes(content_size);
     }
 
     auto status = reader->Finish();
@@ -379,9 +996,10 @@ bool GrpcRunner::DoRandomRead(
                                         run_end - run_start, total_bytes);
 
     watcher_->NotifyCompleted(
-        OperationType::Read, thread_id, GetChannelId(storage.handle),
+        OperationType::Read, thread_id, storage.channel_id,
         context.peer(), parameters_.bucket, object, status, total_bytes,
-        run_start, run_end - run_start, std::move(chunks));
+        run_start, run_end - run_start, throttled_time, std::move(chunks),
+        GetTrafficClassName(traffic_class), GetPartitionName(storage));
 
     if (status.ok()) {
       ;
@@ -396,6 +1014,109 @@ bool GrpcRunner::DoRandomRead(
   return true;
 }
 
+// Creates and connects a new channel for every run and makes a call on it,
+// timing each phase separately. DNS is measured by resolving the host ahead
+// of the channel, which then connects to the resolved address so that its
+// connect time is its own TCP connection plus the TLS or ALTS handshake.
+// With tcp_probe, a TCP connection of its own is timed in between.
+bool GrpcRunner::DoConnect(int thread_id) {
+  Throttler throttler(parameters_.bandwidth_limit, parameters_.ops_limit,
+                      global_bandwidth_limiter_, global_ops_limiter_);
+  const absl::Duration connect_timeout =
+      parameters_.timeout == absl::InfiniteDuration() ? absl::Seconds(30)
+                                                      : parameters_.timeout;
+  std::string target = parameters_.host;
+  if (target.empty()) {
+    target = "storage.googleapis.com";
+  }
+  while (true) {
+    auto work = work_queue_->pop(thread_id);
+    auto work_tid = std::get<0>(work);
+    auto work_run = std::get<1>(work);
+    if (work_run == 0) {
+      break;
+    }
+    absl::Duration throttled_time = throttler.AcquireOperation();
+    std::string object = object_resolver_.Resolve(work_tid, work_run);
+
+    RunnerWatcher::ChannelSetup setup;
+    setup.time = absl::Now();
+    std::string host;
+    std::string resolved_target;
+    struct sockaddr_storage addr;
+    socklen_t addr_len = 0;
+    grpc::Status status;
+    std::string peer;
+    if (!ResolveTarget(target, &host, &resolved_target, &addr, &addr_len)) {
+      status = grpc::Status(grpc::StatusCode::UNAVAILABLE, "DNS failure");
+    }
+    absl::Time resolved = absl::Now();
+    setup.dns_time = resolved - setup.time;
+    absl::Time tcp_connected = resolved;
+    if (status.ok() && parameters_.tcp_probe) {
+      if (!ConnectTcp(addr, addr_len, connect_timeout)) {
+        status = grpc::Status(grpc::StatusCode::UNAVAILABLE, "TCP failure");
+      }
+      tcp_connected = absl::Now();
+      setup.tcp_time = tcp_connected - resolved;
+    }
+
+    if (status.ok()) {
+      // The channel connects to the address but still verifies the server
+      // certificate against the host name.
+      ChannelArgsProfile channel_args = parameters_.channel_args;
+      channel_args.args.emplace_back(GRPC_SSL_TARGET_NAME_OVERRIDE_ARG, host);
+      auto channel = CreateGrpcChannel(
+          resolved_target, parameters_.access_token, parameters_.network,
+          parameters_.cred, parameters_.ssl_cert, parameters_.rr,
+          parameters_.wrr, parameters_.td, parameters_.tx_zerocopy,
+          parameters_.cache_credentials, parameters_.ssl_session_cache,
+          parameters_.compression, channel_args);
+      absl::Time created = absl::Now();
+      setup.create_time = created - tcp_connected;
+      setup.connected = channel->WaitForConnected(
+          absl::ToChronoTime(created + connect_timeout));
+      absl::Time ready = absl::Now();
+      setup.connect_time = ready - created;
+      if (!setup.connected) {
+        status = grpc::Status(grpc::StatusCode::DEADLINE_EXCEEDED,
+                              "Channel failed to get ready");
+      } else {
+        auto stub = google::storage::v2::Storage::NewStub(channel);
+        grpc::ClientContext context;
+        ApplyRoutingHeaders(&context, parameters_.bucket);
+        ApplyCallTimeout(&context, parameters_.timeout);
+        GetObjectRequest request;
+        request.set_bucket(ToV2BucketName(parameters_.bucket));
+        request.set_object(object);
+        Object reply;
+        status = stub->GetObject(&context, request, &reply);
+        // Any answer from the server completes the setup.
+        if (status.error_code() == grpc::StatusCode::NOT_FOUND) {
+          status = grpc::Status::OK;
+        }
+        peer = context.peer();
+        setup.first_call_time = absl::Now() - ready;
+      }
+    }
+    absl::Time run_end = absl::Now();
+
+    if (!status.ok()) {
+      std::cerr << "Connect Failure!" << std::endl;
+      std::cerr << "Target: " << target << std::endl;
+      std::cerr << "Status: " << status.error_code() << " "
+                << status.error_message() << std::endl;
+    }
+    watcher_->NotifyChannelSetup(setup);
+    watcher_->NotifyCompleted(OperationType::Connect, work_tid, 0, peer,
+                              parameters_.bucket, object, status, 0,
+                              setup.time, run_end - setup.time,
+                              throttled_time, {});
+  }
+
+  return true;
+}
+
 bool GrpcRunner::DoWrite(
     int thread_id, std::shared_ptr<StorageStubProvider> storage_stub_provider) {
   const int64_t max_chunk_size =
@@ -410,15 +1131,28 @@ bool GrpcRunner::DoWrite(
     return false;
   }
 
+  Throttler throttler(parameters_.bandwidth_limit, parameters_.ops_limit,
+                      global_bandwidth_limiter_, global_ops_limiter_);
+  const TrafficClass traffic_class =
+      GetTrafficClass(OperationType::Write, parameters_.write_size);
   while (true) {
+    if (concurrency_controller_ != nullptr) {
+      concurrency_controller_->WaitForTurn(thread_id);
+    }
     auto work = work_queue_->pop(thread_id);
     auto work_tid = std::get<0>(work);
     auto work_run = std::get<1>(work);
     if (work_run == 0) {
+      // Releases held-back threads since there is nothing left for them.
+      if (concurrency_controller_ != nullptr) {
+        concurrency_controller_->Stop();
+      }
       break;
     }
     while (true) {
-      auto storage = storage_stub_provider->GetStorageStub();
+      absl::Duration throttled_time = throttler.AcquireOperation();
+      auto storage =
+          storage_stub_provider->GetStorageStubForClass(traffic_class);
 
       std::string object = object_resolver_.Resolve(work_tid, work_run);
       absl::Time run_start = absl::Now();
@@ -448,6 +1182,7 @@ bool GrpcRunner::DoWrite(
       grpc::ClientContext context;
       ApplyRoutingHeaders(&context, parameters_.bucket);
       ApplyCallTimeout(&context, parameters_.timeout);
+      ApplyCallCompression(&context, parameters_.call_compression);
       WriteObjectResponse reply;
       std::unique_ptr<grpc::ClientWriter<WriteObjectRequest>> writer(
           storage.stub->WriteObject(&context, &reply));
@@ -474,7 +1209,8 @@ bool GrpcRunner::DoWrite(
           }
         }
 
-        absl::Cord content = GetRandomData(chunk_size);
+        absl::Cord content = GetCompressibleData(
+            chunk_size, parameters_.write_compression_ratio);
         request.mutable_checksummed_data()->set_content(content);
         if (parameters_.crc32c) {
           auto& content = request.mutable_checksummed_data()->content();
@@ -494,6 +1230,7 @@ bool GrpcRunner::DoWrite(
           }
         }
 
+        throttled_time += throttler.AcquireBytes(chunk_size);
         if (!writer->Write(request)) break;
 
         RunnerWatcher::Chunk chunk = {absl::Now(), chunk_size};
@@ -524,9 +1261,13 @@ bool GrpcRunner::DoWrite(
                                           run_end - run_start, total_bytes);
 
       watcher_->NotifyCompleted(
-          OperationType::Write, work_tid, GetChannelId(storage.handle),
+          OperationType::Write, work_tid, storage.channel_id,
           context.peer(), parameters_.bucket, object, status, total_bytes,
-          run_start, run_end - run_start, std::move(chunks));
+          run_start, run_end - run_start, throttled_time, std::move(chunks),
+          GetTrafficClassName(traffic_class), GetPartitionName(storage));
+      if (concurrency_controller_ != nullptr) {
+        concurrency_controller_->Report(total_bytes, run_end - run_start);
+      }
 
       if (status.ok()) {
         break;
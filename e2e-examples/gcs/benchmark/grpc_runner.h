@@ -19,35 +19,66 @@
 
 #include <functional>
 #include <memory>
+#include <string>
 
 #include "channel_policy.h"
+#include "concurrency_controller.h"
+#include "inproc_server.h"
 #include "object_resolver.h"
 #include "parameters.h"
+#include "rate_limiter.h"
 #include "runner.h"
 #include "runner_watcher.h"
 #include "work_queue.h"
 
 class GrpcRunner : public Runner {
  public:
-  GrpcRunner(Parameters parameters, std::shared_ptr<RunnerWatcher> watcher);
+  // Channels are created from parameters unless channel_creator is given.
+  GrpcRunner(Parameters parameters, std::shared_ptr<RunnerWatcher> watcher,
+             std::function<std::shared_ptr<grpc::Channel>()> channel_creator =
+                 nullptr);
   virtual bool Run() override;
 
  private:
+  bool RunShards();
+  bool PrewarmChannels(
+      const std::vector<std::shared_ptr<grpc::Channel>>& channels);
+  bool CreateStubPool(
+      std::function<std::shared_ptr<grpc::Channel>()> channel_creator,
+      int carg, std::shared_ptr<StorageStubProvider>* stub_pool);
+  std::shared_ptr<StorageStubProvider> GetThreadStubProvider(
+      std::function<std::shared_ptr<grpc::Channel>()> channel_creator,
+      std::shared_ptr<StorageStubProvider> stub_pool);
+  TrafficClass GetTrafficClass(OperationType operation_type,
+                               int64_t bytes) const;
+  std::string GetTrafficClassName(TrafficClass traffic_class) const;
+  std::string GetPartitionName(
+      const StorageStubProvider::StubHolder& storage) const;
   bool DoOperation(int thread_id,
                    std::shared_ptr<StorageStubProvider> storage_stub_provider);
   bool DoRead(int thread_id,
               std::shared_ptr<StorageStubProvider> storage_stub_provider);
   bool DoRandomRead(int thread_id,
                     std::shared_ptr<StorageStubProvider> storage_stub_provider);
+  bool DoConnect(int thread_id);
   bool DoWrite(int thread_id,
                std::shared_ptr<StorageStubProvider> storage_stub_provider);
 
  private:
   Parameters parameters_;
   std::function<std::shared_ptr<grpc::Channel>()> channel_creator_;
+  // Serves channels of the inproc network.
+  std::unique_ptr<InProcessServer> inproc_server_;
   ObjectResolver object_resolver_;
   std::shared_ptr<WorkQueue> work_queue_;
+  std::unique_ptr<ConcurrencyController> concurrency_controller_;
   std::shared_ptr<RunnerWatcher> watcher_;
+  std::shared_ptr<RateLimiter> global_bandwidth_limiter_;
+  std::shared_ptr<RateLimiter> global_ops_limiter_;
+  // Set by the parent runner when this runs as one of its shards.
+  int first_thread_id_ = 1;
+  int shard_first_cpu_ = -1;
+  int shard_cpu_count_ = 0;
 };
 
 #endif  // GCS_BENCHMARK_GRPC_RUNNER_H_
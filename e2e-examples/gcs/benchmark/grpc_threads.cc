@@ -0,0 +1,88 @@
+// Copyright 2026 gRPC authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "grpc_threads.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "absl/strings/ascii.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/strip.h"
+
+void ConfigureGrpcThreads(const Parameters& parameters) {
+  // gRPC reads its configuration from the environment when it starts.
+  if (!parameters.poller.empty()) {
+    setenv("GRPC_POLL_STRATEGY", parameters.poller.c_str(), 1);
+  }
+  if (!parameters.grpc_experiments.empty()) {
+    setenv("GRPC_EXPERIMENTS", parameters.grpc_experiments.c_str(), 1);
+  }
+#ifdef __linux__
+  if (!parameters.grpc_cpus.empty()) {
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    for (int cpu : parameters.grpc_cpus) {
+      CPU_SET(cpu, &cpu_set);
+    }
+    if (sched_setaffinity(0, sizeof(cpu_set), &cpu_set) != 0) {
+      std::cerr << "Failed to set grpc_cpus" << std::endl;
+    }
+  }
+#endif
+}
+
+void PinBenchmarkThread(const Parameters& parameters) {
+#ifdef __linux__
+  if (parameters.grpc_cpus.empty()) {
+    return;
+  }
+  const int cpus = std::thread::hardware_concurrency();
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  for (int cpu = 0; cpu < cpus; cpu++) {
+    CPU_SET(cpu, &cpu_set);
+  }
+  for (int cpu : parameters.grpc_cpus) {
+    CPU_CLR(cpu, &cpu_set);
+  }
+  // Shares the CPUs of gRPC when it has taken all of them.
+  if (CPU_COUNT(&cpu_set) == 0) {
+    return;
+  }
+  if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) != 0) {
+    std::cerr << "Failed to pin the benchmark thread" << std::endl;
+  }
+#endif
+}
+
+int GetThreadCount() {
+  std::ifstream file("/proc/self/status");
+  std::string line;
+  while (std::getline(file, line)) {
+    absl::string_view value = line;
+    int threads;
+    if (absl::ConsumePrefix(&value, "Threads:") &&
+        absl::SimpleAtoi(absl::StripAsciiWhitespace(value), &threads)) {
+      return threads;
+    }
+  }
+  return -1;
+}
@@ -0,0 +1,32 @@
+// Copyright 2026 gRPC authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef GCS_BENCHMARK_GRPC_THREADS_H_
+#define GCS_BENCHMARK_GRPC_THREADS_H_
+
+#include "parameters.h"
+
+// Sets the poller and experiments of gRPC and keeps threads of the process
+// on grpc_cpus so that threads gRPC starts later inherit them. Needs to be
+// called before gRPC gets initialized.
+void ConfigureGrpcThreads(const Parameters& parameters);
+
+// Moves the calling benchmark thread off the CPUs of gRPC threads. Does
+// nothing unless grpc_cpus is given.
+void PinBenchmarkThread(const Parameters& parameters);
+
+// Returns the number of threads of the process or -1 if it is unknown.
+int GetThreadCount();
+
+#endif  // GCS_BENCHMARK_GRPC_THREADS_H_
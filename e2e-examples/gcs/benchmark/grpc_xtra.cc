@@ -24,9 +24,9 @@
 
 #include "absl/memory/memory.h"
 #include "absl/strings/str_cat.h"
+#include "channel_prober.h"
 #include "google/storage/v2/storage.grpc.pb.h"
 #include "parameters.h"
-#include "src/proto/grpc/health/v1/health.grpc.pb.h"
 
 int run_ctest(std::function<std::shared_ptr<grpc::Channel>()> channel_creator,
               const Parameters& parameters) {
@@ -38,18 +38,12 @@ int run_ctest(std::function<std::shared_ptr<grpc::Channel>()> channel_creator,
   std::vector<ChannelState> states;
   const int size = parameters.ctest;
   for (int i = 0; i < size; i++) {
-    states.push_back(ChannelState{channel_creator()});
+    states.push_back(ChannelState{channel_creator(), nullptr, ""});
   }
   for (int i = 0; i < size; i++) {
     ChannelState& cur_state = states[i];
     cur_state.thread = absl::make_unique<std::thread>([&cur_state]() {
-      grpc::health::v1::HealthCheckRequest request;
-      request.set_service("google.storage.v1.Storage");
-      grpc::health::v1::HealthCheckResponse response;
-      grpc::ClientContext context;
-      auto stub = grpc::health::v1::Health::NewStub(cur_state.channel);
-      auto s = stub->Check(&context, request, &response);
-      cur_state.peer = context.peer();
+      cur_state.peer = ProbePeer(cur_state.channel);
     });
   }
   std::for_each(states.begin(), states.end(),
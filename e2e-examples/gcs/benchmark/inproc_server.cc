@@ -0,0 +1,41 @@
+// Copyright 2026 gRPC authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "inproc_server.h"
+
+#include <grpcpp/server_builder.h>
+
+std::unique_ptr<InProcessServer> InProcessServer::Start() {
+  std::unique_ptr<InProcessServer> server(new InProcessServer());
+  grpc::ServerBuilder builder;
+  builder.RegisterService(&server->service_);
+  server->server_ = builder.BuildAndStart();
+  if (server->server_ == nullptr) {
+    return nullptr;
+  }
+  return server;
+}
+
+InProcessServer::~InProcessServer() {
+  if (server_ != nullptr) {
+    server_->Shutdown();
+  }
+}
+
+std::shared_ptr<grpc::Channel> InProcessServer::CreateChannel(
+    const ChannelArgsProfile& channel_args_profile) {
+  grpc::ChannelArguments channel_args;
+  ApplyChannelArgsProfile(channel_args_profile, &channel_args);
+  return server_->InProcessChannel(channel_args);
+}
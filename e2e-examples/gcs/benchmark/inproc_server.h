@@ -0,0 +1,47 @@
+// Copyright 2026 gRPC authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef GCS_BENCHMARK_INPROC_SERVER_H_
+#define GCS_BENCHMARK_INPROC_SERVER_H_
+
+#include <grpcpp/channel.h>
+#include <grpcpp/server.h>
+
+#include <memory>
+
+#include "channel_args_profile.h"
+#include "e2e-examples/gcs/dummy_server/storage_service.h"
+
+// Dummy storage server running in the benchmark process. Its channels skip
+// the network and the kernel so that a run over them shows the cost of the
+// gRPC library alone.
+class InProcessServer {
+ public:
+  // Returns nullptr if the server cannot be started.
+  static std::unique_ptr<InProcessServer> Start();
+
+  ~InProcessServer();
+
+  std::shared_ptr<grpc::Channel> CreateChannel(
+      const ChannelArgsProfile& channel_args_profile);
+
+ private:
+  InProcessServer() = default;
+
+ private:
+  StorageServiceImpl service_;
+  std::unique_ptr<grpc::Server> server_;
+};
+
+#endif  // GCS_BENCHMARK_INPROC_SERVER_H_
@@ -25,10 +25,13 @@
 #include "grpc_admin.h"
 #include "grpc_otel.h"
 #include "grpc_runner.h"
+#include "grpc_threads.h"
 #include "parameters.h"
 #include "print_result.h"
+#include "rss_sampler.h"
 #include "runner.h"
 #include "test/core/test_util/stack_tracer.h"
+#include "tuner.h"
 
 int main(int argc, char **argv) {
   grpc_core::testing::InitializeStackTracer(argv[0]);
@@ -38,6 +41,9 @@ int main(int argc, char **argv) {
   if (!parameters.has_value()) {
     return 1;
   }
+  ConfigureGrpcThreads(*parameters);
+  SetChannelResourceQuota(parameters->memory_quota);
+  SetXdsBootstrap(parameters->xds_server);
 
   if (parameters->prometheus_endpoint != "") {
     absl::Status s = StartGrpcOpenTelemetry(parameters->prometheus_endpoint);
@@ -52,6 +58,12 @@ int main(int argc, char **argv) {
     StartGrpcAdmin(parameters->grpc_admin);
   }
 
+  if (!parameters->tune.empty()) {
+    bool ok = RunTuner(*parameters);
+    StopGrpcAdmin();
+    return ok ? 0 : 1;
+  }
+
   // Create a runner based on a client
   auto watcher = std::make_shared<RunnerWatcher>(
       parameters->warmups * parameters->threads, parameters->verbose);
@@ -69,16 +81,28 @@ int main(int argc, char **argv) {
   // Let's run!
   absl::Time run_start = absl::Now();
   watcher->SetStartTime(run_start);
+  std::unique_ptr<RssSampler> rss_sampler;
+  if (parameters->rss_interval > absl::ZeroDuration()) {
+    rss_sampler.reset(new RssSampler(parameters->rss_interval, watcher));
+  }
   if (!runner->Run()) {
     std::cerr << "Runner failed to complete a run." << std::endl;
     return 1;
   }
+  rss_sampler.reset();
   watcher->SetDuration(absl::Now() - run_start);
 
   StopGrpcAdmin();
 
   // Results
   PrintResult(*watcher);
+  if (parameters->wrr) {
+    PrintPeerShares(*watcher, absl::Seconds(1));
+  }
+  if (parameters->memory_quota > 0 ||
+      parameters->rss_interval > absl::ZeroDuration()) {
+    PrintMemoryUsage(*watcher, parameters->memory_quota);
+  }
   if (!parameters->report_file.empty()) {
     WriteReport(*watcher, parameters->report_file, parameters->report_tag);
   }
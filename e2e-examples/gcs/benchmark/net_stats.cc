@@ -0,0 +1,47 @@
+// Copyright 2026 gRPC authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "net_stats.h"
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_split.h"
+
+bool ReadNetStats(NetStats* stats) {
+  // Each group of counters takes two lines, one of names and one of values.
+  std::ifstream file("/proc/net/netstat");
+  std::string names;
+  std::string values;
+  while (std::getline(file, names) && std::getline(file, values)) {
+    if (names.rfind("IpExt:", 0) != 0) {
+      continue;
+    }
+    std::vector<std::string> n = absl::StrSplit(names, ' ');
+    std::vector<std::string> v = absl::StrSplit(values, ' ');
+    bool found_in = false;
+    bool found_out = false;
+    for (size_t i = 1; i < n.size() && i < v.size(); i++) {
+      if (n[i] == "InOctets") {
+        found_in = absl::SimpleAtoi(v[i], &stats->in_octets);
+      } else if (n[i] == "OutOctets") {
+        found_out = absl::SimpleAtoi(v[i], &stats->out_octets);
+      }
+    }
+    return found_in && found_out;
+  }
+  return false;
+}
@@ -0,0 +1,31 @@
+// Copyright 2026 gRPC authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef GCS_BENCHMARK_NET_STATS_H_
+#define GCS_BENCHMARK_NET_STATS_H_
+
+#include <cstdint>
+
+// Bytes which went through the IP layer including headers and TLS records.
+struct NetStats {
+  int64_t in_octets = 0;
+  int64_t out_octets = 0;
+};
+
+// Reads the IP byte counters of the network namespace of the process. They
+// cover every process in the namespace so the numbers are meaningful only
+// on a host running nothing else. Returns false if they are not available.
+bool ReadNetStats(NetStats* stats);
+
+#endif  // GCS_BENCHMARK_NET_STATS_H_
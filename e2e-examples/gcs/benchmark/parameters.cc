@@ -14,15 +14,23 @@
 
 #include "parameters.h"
 
+#include <sched.h>
+
 #include <iostream>
+#include <thread>
 
 #include "absl/flags/flag.h"
 #include "absl/flags/parse.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_split.h"
+#include "backend_list.h"
+#include "channel_args_profile.h"
+#include "channel_scorer.h"
 
 ABSL_FLAG(std::string, client, "grpc",
           "Client (grpc, gcscpp-json, gcscpp-grpc)");
 ABSL_FLAG(std::string, operation, "read",
-          "Operation type (read, random-read, write)");
+          "Operation type (read, random-read, write, connect)");
 ABSL_FLAG(std::string, bucket, "gcs-grpc-team-veblush1",
           "Bucket to fetch object from");
 ABSL_FLAG(std::string, object, "1G.txt", "Object to download");
@@ -38,6 +46,9 @@ ABSL_FLAG(int64_t, chunk_size, -1, "Chunk size for random-read and write");
 ABSL_FLAG(int64_t, read_offset, -1, "Read offset for read");
 ABSL_FLAG(int64_t, read_limit, -1, "Read limit for read");
 ABSL_FLAG(int64_t, write_size, 0, "Write size");
+ABSL_FLAG(double, write_compression_ratio, 1.0,
+          "Ratio of compressed to original size of written data (1 makes it "
+          "incompressible)");
 ABSL_FLAG(absl::Duration, timeout, absl::InfiniteDuration(),
           "Timeout for the call. (Default: none)");
 ABSL_FLAG(int, runs, 1, "The number of times to run the download");
@@ -51,8 +62,43 @@ ABSL_FLAG(bool, wait_threads, false,
           "Wait until all threads are done when any of operations fails");
 ABSL_FLAG(bool, steal_work, false,
           "Whether worker threads can steal work from other threads ");
+ABSL_FLAG(bool, adaptive_concurrency, false,
+          "Find the saturation point by adjusting the number of active threads "
+          "up to --threads (grpc client with read or write only)");
+ABSL_FLAG(int, shards, 0,
+          "Split threads into this many shards, each pinned to its own range "
+          "of cores with its own channels, work queue and stats (grpc client "
+          "only)");
+ABSL_FLAG(int, adaptive_start, 1,
+          "The initial number of active threads for adaptive_concurrency");
+ABSL_FLAG(absl::Duration, adaptive_window, absl::Seconds(5),
+          "The window to measure throughput and latency for "
+          "adaptive_concurrency");
 ABSL_FLAG(bool, verbose, false, "Show debug output and progress updates");
 ABSL_FLAG(int, grpc_admin, 0, "Port for gRPC Admin");
+ABSL_FLAG(int64_t, memory_quota, 0,
+          "Bytes of memory gRPC may use for all channels except inproc ones "
+          "(0 for unlimited)");
+ABSL_FLAG(absl::Duration, rss_interval, absl::ZeroDuration(),
+          "Interval to sample the RSS of the process (0 to disable)");
+ABSL_FLAG(std::string, poller, "",
+          "Poll strategy of gRPC (e.g. epoll1, poll). Default is up to gRPC");
+ABSL_FLAG(std::string, grpc_experiments, "",
+          "gRPC experiments to turn on or off (e.g. -event_engine_client to "
+          "use iomgr)");
+ABSL_FLAG(std::string, grpc_cpus, "",
+          "Comma-separated CPUs to run gRPC threads on. Benchmark threads "
+          "run on the other CPUs");
+
+ABSL_FLAG(int64_t, bandwidth_limit, 0,
+          "Bandwidth limit of each thread in bytes/s (0 for unlimited)");
+ABSL_FLAG(double, ops_limit, 0,
+          "Operation rate limit of each thread in ops/s (0 for unlimited)");
+ABSL_FLAG(int64_t, global_bandwidth_limit, 0,
+          "Bandwidth limit shared by all threads in bytes/s (0 for unlimited)");
+ABSL_FLAG(double, global_ops_limit, 0,
+          "Operation rate limit shared by all threads in ops/s (0 for "
+          "unlimited)");
 
 ABSL_FLAG(std::string, report_tag, "",
           "The user-defined tag to be inserted in the report");
@@ -63,26 +109,110 @@ ABSL_FLAG(std::string, data_file, "", "The data file to dump the all data");
 ABSL_FLAG(std::string, prometheus_endpoint, "", "Prometheus exporter endpoint");
 
 ABSL_FLAG(std::string, host, "", "Host to reach");
+ABSL_FLAG(std::string, backends, "",
+          "Comma-separated backend addresses with optional weights (e.g. "
+          "127.0.0.1:50051=2,[::1]:50052) which channels connect to instead "
+          "of host");
 ABSL_FLAG(std::string, target_api_version, "", "Target API version (for Json)");
 ABSL_FLAG(std::string, access_token, "", "Access token for auth");
-ABSL_FLAG(std::string, network, "default", "Network path (default, cfe, dp)");
+ABSL_FLAG(std::string, network, "default",
+          "Network path (default, cfe, dp, uds, inproc, grpclb, xds). uds "
+          "connects to the Unix domain socket at host, inproc runs the dummy "
+          "server in the benchmark process, grpclb looks up grpclb balancers "
+          "of host and xds resolves host through an xDS server");
+ABSL_FLAG(std::string, xds_server, "",
+          "Address of the xDS server (e.g. dummy_server --xds_port) for the "
+          "xds network");
 ABSL_FLAG(std::string, cred, "", "Credential type (insecure,ssl,alts)");
 ABSL_FLAG(std::string, ssl_cert, "",
           "Path to the server SSL certification chain file (use - for insecure "
           "connection)");
 ABSL_FLAG(bool, rr, false,
           "Use round_robin grpclb policy (otherwise pick_first)");
+ABSL_FLAG(bool, wrr, false,
+          "Use weighted_round_robin policy driven by ORCA load reports of "
+          "backends (e.g. dummy_server --orca) listed in host as ipv4:a,b");
 ABSL_FLAG(bool, td, false, "Use Traffic Director");
 ABSL_FLAG(bool, tx_zerocopy, false, "Use TCP TX_ZEROCOPY");
+ABSL_FLAG(bool, cache_credentials, true,
+          "Share credentials and root certificates across channels");
+ABSL_FLAG(int, ssl_session_cache, 0,
+          "Number of TLS sessions kept for channels to resume (0 to disable)");
+ABSL_FLAG(bool, tcp_probe, false,
+          "Time a TCP connection of its own before each connect operation. "
+          "This doubles the connections made to the server");
+ABSL_FLAG(std::string, compression, "",
+          "Compression of messages sent on channels (none, deflate, gzip)");
+ABSL_FLAG(std::string, call_compression, "",
+          "Compression of messages sent on write calls, overriding the one "
+          "of the channel (none, deflate, gzip)");
+ABSL_FLAG(std::string, channel_args_file, "",
+          "File of named channel argument profiles");
+ABSL_FLAG(std::string, channel_args, "",
+          "Name of the profile in channel_args_file to apply to channels");
 ABSL_FLAG(std::string, cpolicy, "",
-          "Channel Policy (perthread, percall, const, pool, bpool, spool) "
-          "Default: const if TD is true else perthread");
+          "Channel Policy (perthread, percall, const, pool, bpool, p2c, ewma, "
+          "spool, dpool, epool) Default: const if TD is true else perthread");
 ABSL_FLAG(
     int, carg, 0,
     "Parameter for cpolicy (e.g. pool uses this as the number of channels)");
+ABSL_FLAG(int, peer_retries, 32,
+          "Number of extra channels dpool may create to find distinct peers");
+ABSL_FLAG(int, epool_target, 8,
+          "Calls in flight per channel above which epool adds a channel");
+ABSL_FLAG(absl::Duration, epool_idle_timeout, absl::Seconds(30),
+          "Time after which epool closes a channel having no call");
+ABSL_FLAG(std::string, score_type, "decay",
+          "How spool scores channels (cumulative, window, decay)");
+ABSL_FLAG(absl::Duration, score_window, absl::Seconds(10),
+          "Window of samples for the window score type");
+ABSL_FLAG(absl::Duration, score_half_life, absl::Seconds(10),
+          "Half-life of samples for the decay score type");
+ABSL_FLAG(int, score_min_samples, 3,
+          "Minimum number of samples for spool to score a channel");
+ABSL_FLAG(double, score_evict_ratio, 1.0 / 3,
+          "spool evicts a channel scoring below this ratio of the best score");
+ABSL_FLAG(bool, prewarm, false,
+          "Connect all channels the run starts with in parallel before it");
+ABSL_FLAG(absl::Duration, prewarm_timeout, absl::Seconds(30),
+          "Time for each channel to get ready during prewarm");
+ABSL_FLAG(int, prewarm_retries, 2,
+          "Number of more times to wait for a channel failing to get ready");
+ABSL_FLAG(std::string, traffic_classes, "",
+          "Split calls into latency and bulk classes by operation type (type) "
+          "or request size (size) and report each class");
+ABSL_FLAG(int64_t, latency_max_bytes, 1024 * 1024,
+          "Largest request in the latency class when traffic_classes=size");
+ABSL_FLAG(int, latency_carg, 0,
+          "carg of the channel partition for the latency class. Default: "
+          "classes share channels");
+ABSL_FLAG(std::string, class_borrow, "none",
+          "Which class may use the other partition when it is idle (none, "
+          "latency, both)");
+ABSL_FLAG(int, latency_threads, 0,
+          "Number of threads doing random-read next to the operation");
 ABSL_FLAG(int, ctest, 0, "Test to get a list of peers from grpclb");
 ABSL_FLAG(int, mtest, 0, "Test to get metadata");
 
+ABSL_FLAG(std::string, tune, "",
+          "Search the best configuration by running short trials (grid, "
+          "random, local)");
+ABSL_FLAG(int, tune_trials, 20,
+          "The number of configurations to try for random and local search");
+ABSL_FLAG(int, tune_repeats, 3, "The number of runs for each configuration");
+ABSL_FLAG(std::string, tune_threads, "",
+          "Comma-separated values of threads to search");
+ABSL_FLAG(std::string, tune_cpolicy, "",
+          "Comma-separated values of cpolicy to search");
+ABSL_FLAG(std::string, tune_carg, "",
+          "Comma-separated values of carg to search");
+ABSL_FLAG(std::string, tune_chunk_size, "",
+          "Comma-separated values of chunk_size to search");
+ABSL_FLAG(std::string, tune_tx_zerocopy, "",
+          "Comma-separated values of tx_zerocopy to search");
+ABSL_FLAG(std::string, tune_channel_args, "",
+          "Comma-separated names of channel_args profiles to search");
+
 const char *ToOperationTypeString(OperationType operationType) {
   switch (operationType) {
     case OperationType::Read:
@@ -91,11 +221,45 @@ const char *ToOperationTypeString(OperationType operationType) {
       return "Random-Read";
     case OperationType::Write:
       return "Write";
+    case OperationType::Connect:
+      return "Connect";
     default:
       return "None";
   }
 }
 
+static bool IsValidChannelPolicy(const std::string &cpolicy) {
+  return cpolicy == "perthread" || cpolicy == "percall" ||
+         cpolicy == "const" || cpolicy == "pool" || cpolicy == "bpool" ||
+         cpolicy == "p2c" || cpolicy == "ewma" || cpolicy == "spool" ||
+         cpolicy == "dpool" || cpolicy == "epool";
+}
+
+// Parses comma-separated values of the flag. Returns false if any of them
+// is not valid.
+template <typename T>
+static bool ParseList(const std::string &name, const std::string &text,
+                      std::vector<T> *values) {
+  for (absl::string_view v : absl::StrSplit(text, ',', absl::SkipEmpty())) {
+    T value;
+    bool ok;
+    if constexpr (std::is_same<T, std::string>::value) {
+      value = std::string(v);
+      ok = true;
+    } else if constexpr (std::is_same<T, bool>::value) {
+      ok = absl::SimpleAtob(v, &value);
+    } else {
+      ok = absl::SimpleAtoi(v, &value);
+    }
+    if (!ok) {
+      std::cerr << "Invalid " << name << ": " << v << std::endl;
+      return false;
+    }
+    values->push_back(value);
+  }
+  return true;
+}
+
 absl::optional<Parameters> GetParameters() {
   Parameters p;
   p.client = absl::GetFlag(FLAGS_client);
@@ -106,6 +270,8 @@ absl::optional<Parameters> GetParameters() {
     p.operation_type = OperationType::RandomRead;
   } else if (p.operation == "write") {
     p.operation_type = OperationType::Write;
+  } else if (p.operation == "connect") {
+    p.operation_type = OperationType::Connect;
   } else {
     std::cerr << "Invalid operation: " << p.operation << std::endl;
     return {};
@@ -119,6 +285,12 @@ absl::optional<Parameters> GetParameters() {
   p.read_offset = absl::GetFlag(FLAGS_read_offset);
   p.read_limit = absl::GetFlag(FLAGS_read_limit);
   p.write_size = absl::GetFlag(FLAGS_write_size);
+  p.write_compression_ratio = absl::GetFlag(FLAGS_write_compression_ratio);
+  if (p.write_compression_ratio <= 0 || p.write_compression_ratio > 1) {
+    std::cerr << "Invalid write_compression_ratio: "
+              << p.write_compression_ratio << std::endl;
+    return {};
+  }
   p.timeout = absl::GetFlag(FLAGS_timeout);
   p.runs = absl::GetFlag(FLAGS_runs);
   p.warmups = absl::GetFlag(FLAGS_warmups);
@@ -128,33 +300,306 @@ absl::optional<Parameters> GetParameters() {
   p.trying = absl::GetFlag(FLAGS_trying);
   p.wait_threads = absl::GetFlag(FLAGS_wait_threads);
   p.steal_work = absl::GetFlag(FLAGS_steal_work);
+  p.adaptive_concurrency = absl::GetFlag(FLAGS_adaptive_concurrency);
+  p.shards = absl::GetFlag(FLAGS_shards);
+  if (p.shards < 0 || p.shards > p.threads) {
+    std::cerr << "Invalid shards: " << p.shards << std::endl;
+    return {};
+  }
+  if (p.shards > 0 && (p.client != "grpc" || p.adaptive_concurrency)) {
+    std::cerr << "shards supports only grpc client without "
+                 "adaptive_concurrency."
+              << std::endl;
+    return {};
+  }
+  p.adaptive_start = absl::GetFlag(FLAGS_adaptive_start);
+  p.adaptive_window = absl::GetFlag(FLAGS_adaptive_window);
+  if (p.adaptive_concurrency) {
+    if (p.client != "grpc" || (p.operation_type != OperationType::Read &&
+                               p.operation_type != OperationType::Write)) {
+      std::cerr << "adaptive_concurrency supports only read and write of "
+                   "grpc client."
+                << std::endl;
+      return {};
+    }
+    if (p.adaptive_window <= absl::ZeroDuration()) {
+      std::cerr << "Invalid adaptive_window: " << p.adaptive_window
+                << std::endl;
+      return {};
+    }
+  }
   p.verbose = absl::GetFlag(FLAGS_verbose);
   p.grpc_admin = absl::GetFlag(FLAGS_grpc_admin);
+  p.memory_quota = absl::GetFlag(FLAGS_memory_quota);
+  p.rss_interval = absl::GetFlag(FLAGS_rss_interval);
+  if (p.memory_quota < 0 || p.rss_interval < absl::ZeroDuration()) {
+    std::cerr << "memory_quota and rss_interval should not be negative."
+              << std::endl;
+    return {};
+  }
+  p.poller = absl::GetFlag(FLAGS_poller);
+  p.grpc_experiments = absl::GetFlag(FLAGS_grpc_experiments);
+  if (!ParseList("grpc_cpus", absl::GetFlag(FLAGS_grpc_cpus), &p.grpc_cpus)) {
+    return {};
+  }
+  // CPUs past the end of cpu_set_t can't be set in it.
+  int cpu_count = static_cast<int>(std::thread::hardware_concurrency());
+#ifdef __linux__
+  if (cpu_count <= 0 || cpu_count > CPU_SETSIZE) {
+    cpu_count = CPU_SETSIZE;
+  }
+#endif
+  for (int cpu : p.grpc_cpus) {
+    if (cpu < 0 || (cpu_count > 0 && cpu >= cpu_count)) {
+      std::cerr << "Invalid grpc_cpus: " << cpu << std::endl;
+      return {};
+    }
+  }
+  p.bandwidth_limit = absl::GetFlag(FLAGS_bandwidth_limit);
+  p.ops_limit = absl::GetFlag(FLAGS_ops_limit);
+  p.global_bandwidth_limit = absl::GetFlag(FLAGS_global_bandwidth_limit);
+  p.global_ops_limit = absl::GetFlag(FLAGS_global_ops_limit);
+  if (p.bandwidth_limit < 0 || p.ops_limit < 0 ||
+      p.global_bandwidth_limit < 0 || p.global_ops_limit < 0) {
+    std::cerr << "Rate limits should not be negative." << std::endl;
+    return {};
+  }
   p.report_tag = absl::GetFlag(FLAGS_report_tag);
   p.report_file = absl::GetFlag(FLAGS_report_file);
   p.data_file = absl::GetFlag(FLAGS_data_file);
   p.prometheus_endpoint = absl::GetFlag(FLAGS_prometheus_endpoint);
   p.host = absl::GetFlag(FLAGS_host);
+  auto backends = ParseBackends(absl::GetFlag(FLAGS_backends));
+  if (!backends.has_value()) {
+    return {};
+  }
+  p.backends = std::move(*backends);
   p.target_api_version = absl::GetFlag(FLAGS_target_api_version);
   p.access_token = absl::GetFlag(FLAGS_access_token);
   p.network = absl::GetFlag(FLAGS_network);
   p.cred = absl::GetFlag(FLAGS_cred);
   p.ssl_cert = absl::GetFlag(FLAGS_ssl_cert);
   p.rr = absl::GetFlag(FLAGS_rr);
+  p.wrr = absl::GetFlag(FLAGS_wrr);
   p.td = absl::GetFlag(FLAGS_td);
+  if (p.operation_type == OperationType::Connect &&
+      (p.client != "grpc" || p.td || p.network == "xds" || p.shards > 0)) {
+    std::cerr << "connect supports only grpc client without td, xds and "
+              << "shards." << std::endl;
+    return {};
+  }
+  if (p.wrr && p.td) {
+    std::cerr << "wrr cannot be used with td." << std::endl;
+    return {};
+  }
+  if ((p.network == "uds" || p.network == "inproc") &&
+      (p.client != "grpc" || p.td ||
+       p.operation_type == OperationType::Connect)) {
+    std::cerr << p.network << " supports only grpc client without td and "
+              << "connect." << std::endl;
+    return {};
+  }
+  if (p.network == "uds" && p.host.empty()) {
+    std::cerr << "uds needs the socket path as host." << std::endl;
+    return {};
+  }
+  p.xds_server = absl::GetFlag(FLAGS_xds_server);
+  if (p.network == "xds" && (p.client != "grpc" || p.td)) {
+    std::cerr << "xds supports only grpc client without td." << std::endl;
+    return {};
+  }
+  if (!p.xds_server.empty() && p.network != "xds") {
+    std::cerr << "xds_server requires xds network." << std::endl;
+    return {};
+  }
+  if (!p.backends.empty() &&
+      (p.client != "grpc" || p.td || p.network == "uds" ||
+       p.network == "inproc" || p.network == "xds" ||
+       p.operation_type == OperationType::Connect)) {
+    std::cerr << "backends supports only grpc client without td, uds, "
+              << "inproc, xds and connect." << std::endl;
+    return {};
+  }
   p.tx_zerocopy = absl::GetFlag(FLAGS_tx_zerocopy);
+  p.cache_credentials = absl::GetFlag(FLAGS_cache_credentials);
+  p.ssl_session_cache = absl::GetFlag(FLAGS_ssl_session_cache);
+  p.tcp_probe = absl::GetFlag(FLAGS_tcp_probe);
+  if (p.tcp_probe && p.operation_type != OperationType::Connect) {
+    std::cerr << "tcp_probe supports only connect." << std::endl;
+    return {};
+  }
+  p.compression = absl::GetFlag(FLAGS_compression);
+  p.call_compression = absl::GetFlag(FLAGS_call_compression);
+  for (const std::string& compression : {p.compression, p.call_compression}) {
+    if (compression != "" && compression != "none" &&
+        compression != "deflate" && compression != "gzip") {
+      std::cerr << "Invalid compression: " << compression << std::endl;
+      return {};
+    }
+  }
+  std::vector<ChannelArgsProfile> profiles;
+  const std::string channel_args_file = absl::GetFlag(FLAGS_channel_args_file);
+  if (!channel_args_file.empty()) {
+    auto loaded = LoadChannelArgsProfiles(channel_args_file);
+    if (!loaded.has_value()) {
+      return {};
+    }
+    profiles = std::move(*loaded);
+  }
+  const std::string channel_args = absl::GetFlag(FLAGS_channel_args);
+  if (!channel_args.empty()) {
+    auto profile = FindChannelArgsProfile(profiles, channel_args);
+    if (!profile.has_value()) {
+      std::cerr << "Invalid channel_args: " << channel_args << std::endl;
+      return {};
+    }
+    p.channel_args = std::move(*profile);
+  }
   p.cpolicy = absl::GetFlag(FLAGS_cpolicy);
   if (p.cpolicy == "") {
     p.cpolicy = p.td ? "const" : "perthread";
   }
-  if (p.cpolicy != "perthread" && p.cpolicy != "percall" &&
-      p.cpolicy != "const" && p.cpolicy != "pool" && p.cpolicy != "bpool" &&
-      p.cpolicy != "spool") {
+  if (!IsValidChannelPolicy(p.cpolicy)) {
     std::cerr << "Invalid cpolicy: " << p.cpolicy << std::endl;
     return {};
   }
   p.carg = absl::GetFlag(FLAGS_carg);
+  p.peer_retries = absl::GetFlag(FLAGS_peer_retries);
+  p.epool_target = absl::GetFlag(FLAGS_epool_target);
+  if (p.epool_target <= 0) {
+    std::cerr << "Invalid epool_target: " << p.epool_target << std::endl;
+    return {};
+  }
+  p.epool_idle_timeout = absl::GetFlag(FLAGS_epool_idle_timeout);
+  p.score_type = absl::GetFlag(FLAGS_score_type);
+  if (!IsValidChannelScorerType(p.score_type)) {
+    std::cerr << "Invalid score_type: " << p.score_type << std::endl;
+    return {};
+  }
+  p.score_window = absl::GetFlag(FLAGS_score_window);
+  p.score_half_life = absl::GetFlag(FLAGS_score_half_life);
+  if (p.score_window <= absl::ZeroDuration() ||
+      p.score_half_life <= absl::ZeroDuration()) {
+    std::cerr << "Invalid score_window or score_half_life" << std::endl;
+    return {};
+  }
+  p.score_min_samples = absl::GetFlag(FLAGS_score_min_samples);
+  if (p.score_min_samples < 1) {
+    std::cerr << "Invalid score_min_samples: " << p.score_min_samples
+              << std::endl;
+    return {};
+  }
+  p.score_evict_ratio = absl::GetFlag(FLAGS_score_evict_ratio);
+  if (p.score_evict_ratio <= 0 || p.score_evict_ratio > 1) {
+    std::cerr << "Invalid score_evict_ratio: " << p.score_evict_ratio
+              << std::endl;
+    return {};
+  }
+  p.prewarm = absl::GetFlag(FLAGS_prewarm);
+  p.prewarm_timeout = absl::GetFlag(FLAGS_prewarm_timeout);
+  p.prewarm_retries = absl::GetFlag(FLAGS_prewarm_retries);
+  if (p.prewarm_retries < 0) {
+    std::cerr << "Invalid prewarm_retries: " << p.prewarm_retries
+              << std::endl;
+    return {};
+  }
+  p.traffic_classes = absl::GetFlag(FLAGS_traffic_classes);
+  if (!p.traffic_classes.empty() && p.traffic_classes != "type" &&
+      p.traffic_classes != "size") {
+    std::cerr << "Invalid traffic_classes: " << p.traffic_classes
+              << std::endl;
+    return {};
+  }
+  p.latency_max_bytes = absl::GetFlag(FLAGS_latency_max_bytes);
+  p.latency_carg = absl::GetFlag(FLAGS_latency_carg);
+  if (p.latency_carg < 0) {
+    std::cerr << "Invalid latency_carg: " << p.latency_carg << std::endl;
+    return {};
+  }
+  if (p.latency_carg > 0 && p.traffic_classes.empty()) {
+    std::cerr << "latency_carg needs traffic_classes." << std::endl;
+    return {};
+  }
+  p.class_borrow = absl::GetFlag(FLAGS_class_borrow);
+  if (p.class_borrow != "none" && p.class_borrow != "latency" &&
+      p.class_borrow != "both") {
+    std::cerr << "Invalid class_borrow: " << p.class_borrow << std::endl;
+    return {};
+  }
+  p.latency_threads = absl::GetFlag(FLAGS_latency_threads);
+  if (p.latency_threads < 0 || p.latency_threads > p.threads) {
+    std::cerr << "Invalid latency_threads: " << p.latency_threads
+              << std::endl;
+    return {};
+  }
+  if ((!p.traffic_classes.empty() || p.latency_threads > 0) &&
+      p.client != "grpc") {
+    std::cerr << "traffic_classes and latency_threads support only grpc "
+                 "client."
+              << std::endl;
+    return {};
+  }
+  // Connect operations make their own channels without any stub pool.
+  if (p.operation_type == OperationType::Connect &&
+      (p.latency_threads > 0 || p.latency_carg > 0)) {
+    std::cerr << "connect cannot be used with latency_threads and "
+                 "latency_carg."
+              << std::endl;
+    return {};
+  }
   p.ctest = absl::GetFlag(FLAGS_ctest);
   p.mtest = absl::GetFlag(FLAGS_mtest);
+  p.tune = absl::GetFlag(FLAGS_tune);
+  if (!p.tune.empty() && (p.network == "inproc" || !p.backends.empty())) {
+    std::cerr << "tune cannot be used with inproc or backends." << std::endl;
+    return {};
+  }
+  p.tune_trials = absl::GetFlag(FLAGS_tune_trials);
+  p.tune_repeats = absl::GetFlag(FLAGS_tune_repeats);
+  if (!ParseList("tune_threads", absl::GetFlag(FLAGS_tune_threads),
+                 &p.tune_threads) ||
+      !ParseList("tune_cpolicy", absl::GetFlag(FLAGS_tune_cpolicy),
+                 &p.tune_cpolicy) ||
+      !ParseList("tune_carg", absl::GetFlag(FLAGS_tune_carg), &p.tune_carg) ||
+      !ParseList("tune_chunk_size", absl::GetFlag(FLAGS_tune_chunk_size),
+                 &p.tune_chunk_size) ||
+      !ParseList("tune_tx_zerocopy", absl::GetFlag(FLAGS_tune_tx_zerocopy),
+                 &p.tune_tx_zerocopy)) {
+    return {};
+  }
+  std::vector<std::string> tune_channel_args;
+  if (!ParseList("tune_channel_args", absl::GetFlag(FLAGS_tune_channel_args),
+                 &tune_channel_args)) {
+    return {};
+  }
+  for (const auto &name : tune_channel_args) {
+    auto profile = FindChannelArgsProfile(profiles, name);
+    if (!profile.has_value()) {
+      std::cerr << "Invalid tune_channel_args: " << name << std::endl;
+      return {};
+    }
+    p.tune_channel_args.push_back(std::move(*profile));
+  }
+  if (!p.tune.empty()) {
+    if (p.tune != "grid" && p.tune != "random" && p.tune != "local") {
+      std::cerr << "Invalid tune: " << p.tune << std::endl;
+      return {};
+    }
+    if (p.client != "grpc") {
+      std::cerr << "tune supports only grpc client." << std::endl;
+      return {};
+    }
+    for (const auto &cpolicy : p.tune_cpolicy) {
+      if (!IsValidChannelPolicy(cpolicy)) {
+        std::cerr << "Invalid tune_cpolicy: " << cpolicy << std::endl;
+        return {};
+      }
+    }
+    if (p.tune_trials <= 0 || p.tune_repeats <= 0) {
+      std::cerr << "tune_trials and tune_repeats should be greater than 0."
+                << std::endl;
+      return {};
+    }
+  }
   return p;
 }
@@ -17,11 +17,14 @@
 
 #include <cstdint>
 #include <string>
+#include <vector>
 
 #include "absl/time/time.h"
 #include "absl/types/optional.h"
+#include "backend_list.h"
+#include "channel_args_profile.h"
 
-enum class OperationType { None, Read, RandomRead, Write };
+enum class OperationType { None, Read, RandomRead, Write, Connect };
 
 const char* ToOperationTypeString(OperationType operationType);
 
@@ -38,6 +41,7 @@ struct Parameters {
   int64_t read_offset;
   int64_t read_limit;
   int64_t write_size;
+  double write_compression_ratio;
   absl::Duration timeout;
   int runs;
   int warmups;
@@ -47,8 +51,22 @@ struct Parameters {
   bool trying;
   bool wait_threads;
   bool steal_work;
+  bool adaptive_concurrency;
+  int shards;
+  int adaptive_start;
+  absl::Duration adaptive_window;
   bool verbose;
   int grpc_admin;
+  int64_t memory_quota;
+  absl::Duration rss_interval;
+  std::string poller;
+  std::string grpc_experiments;
+  std::vector<int> grpc_cpus;
+
+  int64_t bandwidth_limit;
+  double ops_limit;
+  int64_t global_bandwidth_limit;
+  double global_ops_limit;
 
   std::string report_tag;
   std::string report_file;
@@ -57,18 +75,53 @@ struct Parameters {
   std::string prometheus_endpoint;
 
   std::string host;
+  std::vector<Backend> backends;
   std::string target_api_version;
   std::string access_token;
   std::string network;
+  std::string xds_server;
   std::string cred;
   std::string ssl_cert;
   bool rr;
+  bool wrr;
   bool td;
   bool tx_zerocopy;
+  bool cache_credentials;
+  int ssl_session_cache;
+  bool tcp_probe;
+  std::string compression;
+  std::string call_compression;
+  ChannelArgsProfile channel_args;
   std::string cpolicy;
   int carg;
+  int peer_retries;
+  int epool_target;
+  absl::Duration epool_idle_timeout;
+  std::string score_type;
+  absl::Duration score_window;
+  absl::Duration score_half_life;
+  int score_min_samples;
+  double score_evict_ratio;
+  bool prewarm;
+  absl::Duration prewarm_timeout;
+  int prewarm_retries;
+  std::string traffic_classes;
+  int64_t latency_max_bytes;
+  int latency_carg;
+  std::string class_borrow;
+  int latency_threads;
   int ctest;
   int mtest;
+
+  std::string tune;
+  int tune_trials;
+  int tune_repeats;
+  std::vector<int> tune_threads;
+  std::vector<std::string> tune_cpolicy;
+  std::vector<int> tune_carg;
+  std::vector<int64_t> tune_chunk_size;
+  std::vector<bool> tune_tx_zerocopy;
+  std::vector<ChannelArgsProfile> tune_channel_args;
 };
 
 absl::optional<Parameters> GetParameters();
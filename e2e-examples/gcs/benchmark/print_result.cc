@@ -16,8 +16,10 @@
 
 #include <sys/resource.h>
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
+#include <map>
 #include <memory>
 #include <string>
 #include <unordered_map>
@@ -27,6 +29,7 @@
 #include "absl/strings/str_join.h"
 #include "absl/strings/str_replace.h"
 #include "absl/time/time.h"
+#include "grpc_threads.h"
 
 constexpr double kMB = 1024.0 * 1024.0;
 constexpr double kSevenPercentiles[] = {0.001, 0.01, 0.10, 0.50,
@@ -93,6 +96,39 @@ std::vector<PeerValue> GetSortedPeers(
   return peers;
 }
 
+// Operations started within this window before and after an eviction are
+// compared to see its impact.
+constexpr absl::Duration kEvictionWindow = absl::Seconds(5);
+
+struct WindowStats {
+  size_t count = 0;
+  double throughput = 0;
+  absl::Duration p99_time;
+};
+
+WindowStats GetWindowStats(
+    const std::vector<RunnerWatcher::Operation>& operations, absl::Time start,
+    absl::Time end) {
+  WindowStats stats;
+  int64_t total_bytes = 0;
+  absl::Duration total_time;
+  std::vector<absl::Duration> times;
+  for (const auto& op : operations) {
+    if (op.status.ok() && op.time >= start && op.time < end) {
+      total_bytes += op.bytes;
+      total_time += op.elapsed_time;
+      times.push_back(op.elapsed_time);
+    }
+  }
+  stats.count = times.size();
+  if (!times.empty()) {
+    std::sort(times.begin(), times.end());
+    stats.throughput = total_bytes / absl::ToDoubleSeconds(total_time);
+    stats.p99_time = times[size_t(0.99 * times.size())];
+  }
+  return stats;
+}
+
 void PrintResult(const RunnerWatcher& watcher) {
   auto operations = watcher.GetNonWarmupsOperations();
   if (operations.empty()) {
@@ -114,6 +150,24 @@ void PrintResult(const RunnerWatcher& watcher) {
              total_bytes / kMB / elapsed_time)
       << std::endl;
 
+  // Rate limiting
+
+  // Throttled time includes waits before operations start, which are not
+  // part of elapsed_time, so it is not reported as a share of it.
+  absl::Duration total_throttled_time;
+  for (auto& op : operations) {
+    total_throttled_time += op.throttled_time;
+  }
+  if (total_throttled_time > absl::ZeroDuration()) {
+    std::cout << absl::StrFormat(
+                     "Throttled (including waits before operations): %.1fs "
+                     "Average: %.3fs",
+                     absl::ToDoubleSeconds(total_throttled_time),
+                     absl::ToDoubleSeconds(total_throttled_time /
+                                           operations.size()))
+              << std::endl;
+  }
+
   // Resource usage
 
   struct rusage ru;
@@ -126,6 +180,9 @@ void PrintResult(const RunnerWatcher& watcher) {
         "stime: %.1fs ",
         absl::ToDoubleSeconds(absl::DurationFromTimeval(ru.ru_stime)));
     std::cout << absl::StrFormat("maxrss: %.2fMB ", ru.ru_maxrss / 1024.0);
+    std::cout << absl::StrFormat("nvcsw: %d ", ru.ru_nvcsw);
+    std::cout << absl::StrFormat("nivcsw: %d ", ru.ru_nivcsw);
+    std::cout << absl::StrFormat("threads: %d ", GetThreadCount());
     std::cout << "]" << std::endl;
   }
 
@@ -170,6 +227,127 @@ void PrintResult(const RunnerWatcher& watcher) {
                      subt[2] / kMB, subt[4] / kMB, peer.total_count, peer.peer)
               << std::endl;
   }
+
+  // Latency for each traffic class
+
+  std::map<std::string, std::vector<size_t>> class_map;
+  for (size_t i = 0; i < operations.size(); i++) {
+    if (!operations[i].traffic_class.empty()) {
+      class_map[operations[i].traffic_class].push_back(i);
+    }
+  }
+  if (!class_map.empty()) {
+    std::cout << std::endl << "Traffic classes" << std::endl;
+    for (auto& entry : class_map) {
+      auto& indexes = entry.second;
+      std::sort(indexes.begin(), indexes.end(),
+                [&operations](size_t a, size_t b) {
+                  return operations[a].elapsed_time <
+                         operations[b].elapsed_time;
+                });
+      size_t borrowed = 0;
+      int64_t bytes = 0;
+      for (size_t index : indexes) {
+        const auto& op = operations[index];
+        bytes += op.bytes;
+        if (!op.partition.empty() && op.partition != op.traffic_class) {
+          borrowed += 1;
+        }
+      }
+      auto latency = [&](double p) {
+        size_t index = indexes[size_t(p * indexes.size())];
+        return absl::ToDoubleMilliseconds(operations[index].elapsed_time);
+      };
+      std::cout << absl::StrFormat(
+                       " [%s] Count: %d Borrowed: %d Bytes: %.1fMB "
+                       "Latency: p50:%.1fms p90:%.1fms p99:%.1fms",
+                       entry.first, indexes.size(), borrowed, bytes / kMB,
+                       latency(0.5), latency(0.9), latency(0.99))
+                << std::endl;
+    }
+  }
+
+  // Channel setup
+
+  auto setups = watcher.GetChannelSetups();
+  if (!setups.empty()) {
+    size_t failures = 0;
+    for (const auto& setup : setups) {
+      if (!setup.connected) {
+        failures += 1;
+      }
+    }
+    std::cout << std::endl << "Channel setup" << std::endl;
+    std::cout << absl::StrFormat(" Count: %d Failed: %d", setups.size(),
+                                 failures)
+              << std::endl;
+    using Phase = absl::Duration RunnerWatcher::ChannelSetup::*;
+    const std::pair<const char*, Phase> phases[] = {
+        {"DNS", &RunnerWatcher::ChannelSetup::dns_time},
+        {"TCP probe", &RunnerWatcher::ChannelSetup::tcp_time},
+        {"Create", &RunnerWatcher::ChannelSetup::create_time},
+        {"Connect (TCP + TLS)", &RunnerWatcher::ChannelSetup::connect_time},
+        {"First call", &RunnerWatcher::ChannelSetup::first_call_time}};
+    for (const auto& phase : phases) {
+      std::vector<absl::Duration> times;
+      for (const auto& setup : setups) {
+        times.push_back(setup.*(phase.second));
+      }
+      std::sort(times.begin(), times.end());
+      if (times.back() == absl::ZeroDuration()) {
+        continue;
+      }
+      auto ms = [&times](double p) {
+        return absl::ToDoubleMilliseconds(times[size_t(p * times.size())]);
+      };
+      std::cout << absl::StrFormat(
+                       " [%s] p50:%.2fms p90:%.2fms p99:%.2fms max:%.2fms",
+                       phase.first, ms(0.5), ms(0.9), ms(0.99),
+                       absl::ToDoubleMilliseconds(times.back()))
+                << std::endl;
+    }
+  }
+
+  // Events
+
+  auto events = watcher.GetEvents();
+  if (!events.empty()) {
+    std::cout << std::endl << "Events" << std::endl;
+    for (const auto& event : events) {
+      std::cout << absl::StrFormat(
+                       " [%+.1fs] %s: %d %s",
+                       absl::ToDoubleSeconds(event.time -
+                                             watcher.GetStartTime()),
+                       event.name, event.value, event.detail)
+                << std::endl;
+    }
+  }
+
+  // Eviction impact
+
+  bool has_eviction = false;
+  for (const auto& event : events) {
+    if (event.name != "evict") {
+      continue;
+    }
+    if (!has_eviction) {
+      has_eviction = true;
+      std::cout << std::endl << "Eviction impact" << std::endl;
+    }
+    auto before = GetWindowStats(operations, event.time - kEvictionWindow,
+                                 event.time);
+    auto after = GetWindowStats(operations, event.time,
+                                event.time + kEvictionWindow);
+    std::cout << absl::StrFormat(
+                     " [%+.1fs] Channel: %d Before: %.2fMB/s p99 %.3fs "
+                     "(%d ops) After: %.2fMB/s p99 %.3fs (%d ops)",
+                     absl::ToDoubleSeconds(event.time - watcher.GetStartTime()),
+                     event.value, before.throughput / kMB,
+                     absl::ToDoubleSeconds(before.p99_time), before.count,
+                     after.throughput / kMB,
+                     absl::ToDoubleSeconds(after.p99_time), after.count)
+              << std::endl;
+  }
 }
 
 inline bool FileExists(const std::string& name) {
@@ -177,6 +355,95 @@ inline bool FileExists(const std::string& name) {
   return f.good();
 }
 
+void PrintPeerShares(const RunnerWatcher& watcher, absl::Duration interval) {
+  auto operations = watcher.GetNonWarmupsOperations();
+  if (operations.empty()) {
+    return;
+  }
+
+  std::map<std::string, size_t> peer_map;
+  absl::Time start = operations[0].time;
+  for (const auto& op : operations) {
+    peer_map[op.peer] = 0;
+    start = std::min(start, op.time);
+  }
+  std::cout << std::endl << "Peer shares" << std::endl;
+  size_t peer_count = 0;
+  for (auto& entry : peer_map) {
+    entry.second = peer_count++;
+    std::cout << absl::StrFormat(" [peer%d] %s", entry.second, entry.first)
+              << std::endl;
+  }
+
+  std::vector<std::vector<int64_t>> counts;
+  std::vector<int64_t> total_counts(peer_count);
+  for (const auto& op : operations) {
+    size_t bucket = absl::IDivDuration(op.time - start, interval, nullptr);
+    if (bucket >= counts.size()) {
+      counts.resize(bucket + 1, std::vector<int64_t>(peer_count));
+    }
+    size_t index = peer_map[op.peer];
+    counts[bucket][index] += 1;
+    total_counts[index] += 1;
+  }
+  auto format_shares = [](const std::vector<int64_t>& c) {
+    int64_t sum = 0;
+    for (auto v : c) {
+      sum += v;
+    }
+    std::string line;
+    for (size_t i = 0; i < c.size(); i++) {
+      absl::StrAppendFormat(&line, " peer%d:%5.1f%%", i,
+                            sum > 0 ? 100.0 * c[i] / sum : 0.0);
+    }
+    return line;
+  };
+  for (size_t bucket = 0; bucket < counts.size(); bucket++) {
+    std::cout << absl::StrFormat(
+                     " [%+.1fs]%s",
+                     absl::ToDoubleSeconds(bucket * interval),
+                     format_shares(counts[bucket]))
+              << std::endl;
+  }
+  std::cout << absl::StrFormat(" [total]%s", format_shares(total_counts))
+            << std::endl;
+}
+
+void PrintMemoryUsage(const RunnerWatcher& watcher, int64_t memory_quota) {
+  std::vector<int64_t> samples = watcher.GetRssSamples();
+  size_t exhausted = 0;
+  for (const auto& op : watcher.GetNonWarmupsOperations()) {
+    if (op.status.error_code() == grpc::StatusCode::RESOURCE_EXHAUSTED) {
+      exhausted += 1;
+    }
+  }
+
+  std::cout << std::endl << "Memory" << std::endl;
+  if (!samples.empty()) {
+    std::sort(samples.begin(), samples.end());
+    double sum = 0;
+    for (int64_t sample : samples) {
+      sum += sample;
+    }
+    std::cout << absl::StrFormat(
+                     " RSS samples: %d min:%.1fMB avg:%.1fMB max:%.1fMB",
+                     samples.size(), samples.front() / kMB,
+                     sum / samples.size() / kMB, samples.back() / kMB)
+              << std::endl;
+  }
+  if (memory_quota > 0) {
+    std::cout << absl::StrFormat(" Quota: %.1fMB", memory_quota / kMB);
+    if (!samples.empty()) {
+      // RSS covers more than gRPC so this is an upper bound of the pressure.
+      std::cout << absl::StrFormat(" Peak RSS/quota: %.1f%%",
+                                   100.0 * samples.back() / memory_quota);
+    }
+    std::cout << std::endl;
+  }
+  std::cout << absl::StrFormat(" Resource exhausted: %d", exhausted)
+            << std::endl;
+}
+
 void WriteReport(const RunnerWatcher& watcher, std::string report_file,
                  std::string tag) {
   auto operations = watcher.GetNonWarmupsOperations();
@@ -314,6 +581,14 @@ void WriteData(const RunnerWatcher& watcher, std::string file,
     f << absl::StrFormat("\t\t\t\"elapsed_time\": %f,",
                          absl::ToDoubleSeconds(op.elapsed_time))
       << std::endl;
+    f << absl::StrFormat("\t\t\t\"throttled_time\": %f,",
+                         absl::ToDoubleSeconds(op.throttled_time))
+      << std::endl;
+    f << absl::StrFormat("\t\t\t\"traffic_class\": \"%s\",",
+                         op.traffic_class)
+      << std::endl;
+    f << absl::StrFormat("\t\t\t\"partition\": \"%s\",", op.partition)
+      << std::endl;
     f << "\t\t\t\"chunks\": [" << std::endl;
     for (const auto& chunk : op.chunks) {
       f << "\t\t\t\t{" << std::endl;
@@ -327,6 +602,23 @@ void WriteData(const RunnerWatcher& watcher, std::string file,
     f << "\t\t\t]" << std::endl;
     f << "\t\t}," << std::endl;
   }
+  f << "\t]," << std::endl;
+
+  // All events
+
+  f << "\t\"events\": [" << std::endl;
+  for (const auto& event : watcher.GetEvents()) {
+    f << "\t\t{" << std::endl;
+    f << absl::StrFormat("\t\t\t\"time\": \"%s\",",
+                         FullFormatTime(event.time))
+      << std::endl;
+    f << absl::StrFormat("\t\t\t\"name\": \"%s\",", event.name)
+      << std::endl;
+    f << absl::StrFormat("\t\t\t\"value\": %d,", event.value) << std::endl;
+    f << absl::StrFormat("\t\t\t\"detail\": \"%s\",", event.detail)
+      << std::endl;
+    f << "\t\t}," << std::endl;
+  }
   f << "\t]" << std::endl;
   f << "}" << std::endl;
 }
@@ -23,6 +23,14 @@
 
 void PrintResult(const RunnerWatcher& watcher);
 
+// Prints the share of operations each peer got in every interval to show
+// how load balancing weights converge.
+void PrintPeerShares(const RunnerWatcher& watcher, absl::Duration interval);
+
+// Prints RSS samples of the run against the memory quota of channels along
+// with operations which failed for lack of resources.
+void PrintMemoryUsage(const RunnerWatcher& watcher, int64_t memory_quota);
+
 void WriteReport(const RunnerWatcher& watcher, std::string file,
                  std::string tag);
 
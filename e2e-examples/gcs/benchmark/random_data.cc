@@ -14,19 +14,42 @@
 
 #include "random_data.h"
 
+#include <algorithm>
+#include <map>
+#include <cstdint>
+#include <string>
+#include <utility>
+
 #include "absl/random/random.h"
+#include "absl/synchronization/mutex.h"
 
 namespace {
 
+// Every byte comes from a uniform byte generator so that the data doesn't
+// compress at all.
 absl::Cord CreateRandomData(size_t size) {
-  std::vector<char> content(size);
+  std::string content(size, '\0');
   absl::InsecureBitGen gen;
-  int* const s = reinterpret_cast<int*>(&(*content.begin()));
-  int* const e = reinterpret_cast<int*>(&(*content.rbegin()));
-  for (int* c = s; c < e; c += 1) {
-    *c = static_cast<char>(absl::Uniform(gen, 0, 256));
+  for (char& c : content) {
+    c = static_cast<char>(absl::Uniform<uint8_t>(gen));
+  }
+  return absl::Cord(std::move(content));
+}
+
+// Each block starts with random bytes for the ratio and is padded with
+// zeros. Blocks are far smaller than the window of deflate so the zeros
+// compress away while the random bytes never repeat within the window.
+absl::Cord CreateCompressibleData(size_t size, double compression_ratio) {
+  constexpr size_t kBlockSize = 4096;
+  const size_t random_size =
+      static_cast<size_t>(kBlockSize * compression_ratio);
+  const std::string random_data(CreateRandomData(size));
+  std::string content(size, '\0');
+  for (size_t o = 0; o < size; o += kBlockSize) {
+    size_t n = std::min(random_size, size - o);
+    content.replace(o, n, random_data, o, n);
   }
-  return absl::Cord(absl::string_view(content.data(), content.size()));
+  return absl::Cord(content);
 }
 
 }  // namespace
@@ -41,3 +64,27 @@ absl::Cord GetRandomData(size_t size) {
   }
   return ret;
 }
+
+absl::Cord GetCompressibleData(size_t size, double compression_ratio) {
+  if (compression_ratio >= 1) {
+    return GetRandomData(size);
+  }
+  // Pregenerated data is kept for each ratio like random data.
+  static absl::Mutex lock(absl::kConstInit);
+  static auto* cords = new std::map<double, absl::Cord>();
+  absl::Cord data_cord;
+  {
+    absl::MutexLock l(&lock);
+    absl::Cord& cord = (*cords)[compression_ratio];
+    if (cord.empty()) {
+      cord = CreateCompressibleData(1048576, compression_ratio);
+    }
+    data_cord = cord;
+  }
+  absl::Cord ret;
+  while (ret.size() < size) {
+    size_t remain = size - ret.size();
+    ret.Append(data_cord.Subcord(0, std::min(remain, data_cord.size())));
+  }
+  return ret;
+}
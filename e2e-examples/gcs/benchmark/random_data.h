@@ -19,4 +19,8 @@
 
 absl::Cord GetRandomData(size_t size);
 
+// Returns data which compresses to about compression_ratio of its size.
+// A ratio of 1 gives the incompressible data of GetRandomData.
+absl::Cord GetCompressibleData(size_t size, double compression_ratio);
+
 #endif  // GCS_BENCHMARK_RANDOM_DATA_H
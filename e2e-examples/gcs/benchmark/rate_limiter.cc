@@ -0,0 +1,78 @@
+// Copyright 2026 gRPC authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rate_limiter.h"
+
+#include <algorithm>
+
+#include "absl/time/clock.h"
+
+RateLimiter::RateLimiter(double rate, double burst)
+    : rate_(rate), burst_(burst), tokens_(burst), last_refill_(absl::Now()) {}
+
+absl::Duration RateLimiter::Acquire(int64_t tokens) {
+  absl::Duration wait;
+  {
+    absl::MutexLock l(&mu_);
+    absl::Time now = absl::Now();
+    tokens_ = std::min(
+        burst_, tokens_ + absl::ToDoubleSeconds(now - last_refill_) * rate_);
+    last_refill_ = now;
+    tokens_ -= tokens;
+    if (tokens_ >= 0) {
+      return absl::ZeroDuration();
+    }
+    // Borrowed tokens will be refilled after this wait.
+    wait = absl::Seconds(-tokens_ / rate_);
+  }
+  absl::SleepFor(wait);
+  return wait;
+}
+
+std::shared_ptr<RateLimiter> CreateRateLimiter(double rate) {
+  if (rate <= 0) {
+    return nullptr;
+  }
+  return std::make_shared<RateLimiter>(rate, std::max(1.0, rate / 10));
+}
+
+Throttler::Throttler(int64_t bandwidth_limit, double ops_limit,
+                     std::shared_ptr<RateLimiter> global_bandwidth_limiter,
+                     std::shared_ptr<RateLimiter> global_ops_limiter)
+    : bandwidth_limiter_(CreateRateLimiter(bandwidth_limit)),
+      ops_limiter_(CreateRateLimiter(ops_limit)),
+      global_bandwidth_limiter_(std::move(global_bandwidth_limiter)),
+      global_ops_limiter_(std::move(global_ops_limiter)) {}
+
+absl::Duration Throttler::AcquireOperation() {
+  absl::Duration wait;
+  if (ops_limiter_ != nullptr) {
+    wait += ops_limiter_->Acquire(1);
+  }
+  if (global_ops_limiter_ != nullptr) {
+    wait += global_ops_limiter_->Acquire(1);
+  }
+  return wait;
+}
+
+absl::Duration Throttler::AcquireBytes(int64_t bytes) {
+  absl::Duration wait;
+  if (bandwidth_limiter_ != nullptr) {
+    wait += bandwidth_limiter_->Acquire(bytes);
+  }
+  if (global_bandwidth_limiter_ != nullptr) {
+    wait += global_bandwidth_limiter_->Acquire(bytes);
+  }
+  return wait;
+}
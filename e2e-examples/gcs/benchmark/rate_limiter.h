@@ -0,0 +1,69 @@
+// Copyright 2026 gRPC authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef GCS_BENCHMARK_RATE_LIMITER_H_
+#define GCS_BENCHMARK_RATE_LIMITER_H_
+
+#include <cstdint>
+#include <memory>
+
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+
+// Token bucket refilled at `rate` tokens per second and holding up to `burst`
+// tokens. Acquire never fails; a caller takes tokens even when the bucket
+// doesn't have enough and then sleeps until the debt is paid back, so
+// concurrent callers are served in the order they arrive.
+class RateLimiter {
+ public:
+  RateLimiter(double rate, double burst);
+
+  // Takes the given number of tokens and returns the time it slept for them.
+  absl::Duration Acquire(int64_t tokens);
+
+ private:
+  absl::Mutex mu_;
+  double rate_;
+  double burst_;
+  double tokens_;
+  absl::Time last_refill_;
+};
+
+// Returns a rate limiter holding 100ms worth of tokens or nullptr if the rate
+// is not positive, which means no limit.
+std::shared_ptr<RateLimiter> CreateRateLimiter(double rate);
+
+// Applies bandwidth (bytes/s) and operation rate (ops/s) limits to a single
+// worker thread. Per-thread buckets are owned by this while global ones are
+// shared by all worker threads. Any of them can be absent.
+class Throttler {
+ public:
+  Throttler(int64_t bandwidth_limit, double ops_limit,
+            std::shared_ptr<RateLimiter> global_bandwidth_limiter,
+            std::shared_ptr<RateLimiter> global_ops_limiter);
+
+  // Waits for the next operation to be allowed to start.
+  absl::Duration AcquireOperation();
+
+  // Waits for the given number of bytes to be allowed to be transferred.
+  absl::Duration AcquireBytes(int64_t bytes);
+
+ private:
+  std::shared_ptr<RateLimiter> bandwidth_limiter_;
+  std::shared_ptr<RateLimiter> ops_limiter_;
+  std::shared_ptr<RateLimiter> global_bandwidth_limiter_;
+  std::shared_ptr<RateLimiter> global_ops_limiter_;
+};
+
+#endif  // GCS_BENCHMARK_RATE_LIMITER_H_
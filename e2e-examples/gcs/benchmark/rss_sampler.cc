@@ -0,0 +1,55 @@
+// Copyright 2026 gRPC authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rss_sampler.h"
+
+#include <unistd.h>
+
+#include <fstream>
+
+int64_t GetRss() {
+  // The second field of statm is the number of resident pages.
+  std::ifstream file("/proc/self/statm");
+  int64_t size;
+  int64_t resident;
+  if (!(file >> size >> resident)) {
+    return -1;
+  }
+  return resident * sysconf(_SC_PAGESIZE);
+}
+
+RssSampler::RssSampler(absl::Duration interval,
+                       std::shared_ptr<RunnerWatcher> watcher)
+    : interval_(interval), watcher_(std::move(watcher)) {
+  thread_ = std::unique_ptr<std::thread>(
+      new std::thread([this]() { ThreadRun(); }));
+}
+
+RssSampler::~RssSampler() {
+  {
+    absl::MutexLock l(&mu_);
+    shutdown_ = true;
+  }
+  thread_->join();
+}
+
+void RssSampler::ThreadRun() {
+  absl::MutexLock l(&mu_);
+  while (!mu_.AwaitWithTimeout(absl::Condition(&shutdown_), interval_)) {
+    int64_t rss = GetRss();
+    if (rss >= 0) {
+      watcher_->NotifyRssSample(rss);
+    }
+  }
+}
@@ -0,0 +1,47 @@
+// Copyright 2026 gRPC authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef GCS_BENCHMARK_RSS_SAMPLER_H_
+#define GCS_BENCHMARK_RSS_SAMPLER_H_
+
+#include <cstdint>
+#include <memory>
+#include <thread>
+
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "runner_watcher.h"
+
+// Returns the resident set size of the process in bytes or -1 if unknown.
+int64_t GetRss();
+
+// Samples the RSS of the process on its own thread at every interval and
+// records each sample in the watcher until it's destroyed.
+class RssSampler {
+ public:
+  RssSampler(absl::Duration interval, std::shared_ptr<RunnerWatcher> watcher);
+  ~RssSampler();
+
+ private:
+  void ThreadRun();
+
+ private:
+  absl::Duration interval_;
+  std::shared_ptr<RunnerWatcher> watcher_;
+  std::unique_ptr<std::thread> thread_;
+  absl::Mutex mu_;
+  bool shutdown_ ABSL_GUARDED_BY(mu_) = false;
+};
+
+#endif  // GCS_BENCHMARK_RSS_SAMPLER_H_
@@ -14,6 +14,10 @@
 
 #include "runner_watcher.h"
 
+#include <algorithm>
+
+#include "absl/time/clock.h"
+
 RunnerWatcher::RunnerWatcher(size_t warmups, bool verbose)
     : warmups_(warmups), verbose_(verbose) {}
 
@@ -35,7 +39,10 @@ void RunnerWatcher::NotifyCompleted(OperationType operationType,
                                     std::string object, grpc::Status status,
                                     int64_t bytes, absl::Time time,
                                     absl::Duration elapsed_time,
-                                    std::vector<Chunk> chunks) {
+                                    absl::Duration throttled_time,
+                                    std::vector<Chunk> chunks,
+                                    std::string traffic_class,
+                                    std::string partition) {
   Operation op;
   op.type = operationType;
   op.runner_id = runner_id;
@@ -47,7 +54,10 @@ void RunnerWatcher::NotifyCompleted(OperationType operationType,
   op.bytes = bytes;
   op.time = time;
   op.elapsed_time = elapsed_time;
+  op.throttled_time = throttled_time;
   op.chunks = std::move(chunks);
+  op.traffic_class = traffic_class;
+  op.partition = partition;
 
   // Insert records
   size_t ord;
@@ -70,6 +80,68 @@ void RunnerWatcher::NotifyCompleted(OperationType operationType,
   }
 }
 
+void RunnerWatcher::NotifyEvent(std::string name, int64_t value,
+                                std::string detail) {
+  Event event;
+  event.time = absl::Now();
+  event.name = name;
+  event.value = value;
+  event.detail = detail;
+
+  {
+    absl::MutexLock l(&lock_);
+    events_.push_back(std::move(event));
+  }
+
+  if (verbose_) {
+    printf("### Event: name=%s value=%lld %s\n", name.c_str(),
+           (long long)value, detail.c_str());
+    fflush(stdout);
+  }
+}
+
+void RunnerWatcher::NotifyChannelSetup(ChannelSetup setup) {
+  absl::MutexLock l(&lock_);
+  channel_setups_.push_back(setup);
+}
+
+void RunnerWatcher::NotifyRssSample(int64_t rss) {
+  absl::MutexLock l(&lock_);
+  rss_samples_.push_back(rss);
+}
+
+void RunnerWatcher::Merge(const RunnerWatcher& other) {
+  std::vector<Operation> operations;
+  std::vector<Event> events;
+  std::vector<ChannelSetup> channel_setups;
+  std::vector<int64_t> rss_samples;
+  {
+    absl::MutexLock l(&other.lock_);
+    operations = other.operations_;
+    events = other.events_;
+    channel_setups = other.channel_setups_;
+    rss_samples = other.rss_samples_;
+  }
+
+  absl::MutexLock l(&lock_);
+  operations_.insert(operations_.end(),
+                     std::make_move_iterator(operations.begin()),
+                     std::make_move_iterator(operations.end()));
+  std::stable_sort(operations_.begin(), operations_.end(),
+                   [](const Operation& a, const Operation& b) {
+                     return a.time + a.elapsed_time < b.time + b.elapsed_time;
+                   });
+  events_.insert(events_.end(), std::make_move_iterator(events.begin()),
+                 std::make_move_iterator(events.end()));
+  std::stable_sort(
+      events_.begin(), events_.end(),
+      [](const Event& a, const Event& b) { return a.time < b.time; });
+  channel_setups_.insert(channel_setups_.end(), channel_setups.begin(),
+                         channel_setups.end());
+  rss_samples_.insert(rss_samples_.end(), rss_samples.begin(),
+                      rss_samples.end());
+}
+
 std::vector<RunnerWatcher::Operation> RunnerWatcher::GetNonWarmupsOperations()
     const {
   absl::MutexLock l(&lock_);
@@ -80,6 +152,31 @@ std::vector<RunnerWatcher::Operation> RunnerWatcher::GetNonWarmupsOperations()
                                                operations_.end());
 }
 
+int64_t RunnerWatcher::GetTotalBytes() const {
+  absl::MutexLock l(&lock_);
+  int64_t bytes = 0;
+  for (const auto& op : operations_) {
+    bytes += op.bytes;
+  }
+  return bytes;
+}
+
+std::vector<RunnerWatcher::Event> RunnerWatcher::GetEvents() const {
+  absl::MutexLock l(&lock_);
+  return events_;
+}
+
+std::vector<RunnerWatcher::ChannelSetup> RunnerWatcher::GetChannelSetups()
+    const {
+  absl::MutexLock l(&lock_);
+  return channel_setups_;
+}
+
+std::vector<int64_t> RunnerWatcher::GetRssSamples() const {
+  absl::MutexLock l(&lock_);
+  return rss_samples_;
+}
+
 absl::Duration RunnerWatcher::GetNonWarmupsDuration() const {
   auto operations = GetNonWarmupsOperations();
   if (operations.empty()) {
@@ -42,7 +42,39 @@ class RunnerWatcher {
     int64_t bytes;
     absl::Time time;
     absl::Duration elapsed_time;
+    // Time spent waiting for rate limiters. Waits for bytes are included in
+    // elapsed_time but the wait before starting the operation is not.
+    absl::Duration throttled_time;
     std::vector<Chunk> chunks;
+    // Traffic class the operation asked for and the channel partition which
+    // served it. Both are empty unless channels are partitioned by class.
+    std::string traffic_class;
+    std::string partition;
+  };
+
+  struct Event {
+    absl::Time time;
+    std::string name;
+    int64_t value;
+    std::string detail;
+  };
+
+  // Setup of a channel created for a single call or a connect operation.
+  // Phases which are not measured are left zero.
+  struct ChannelSetup {
+    absl::Time time;
+    // Time to resolve the host name
+    absl::Duration dns_time;
+    // Time to open a separate TCP connection to the resolved address
+    absl::Duration tcp_time;
+    // Time to create the channel object including its credentials
+    absl::Duration create_time;
+    // Time for the channel to get ready, which is its TCP connection plus
+    // the TLS handshake
+    absl::Duration connect_time;
+    // Time of the first call on the ready channel
+    absl::Duration first_call_time;
+    bool connected = false;
   };
 
  public:
@@ -60,10 +92,35 @@ class RunnerWatcher {
                        int64_t channel_id, std::string peer, std::string bucket,
                        std::string object, grpc::Status status, int64_t bytes,
                        absl::Time time, absl::Duration elapsed_time,
-                       std::vector<Chunk> chunks);
+                       absl::Duration throttled_time,
+                       std::vector<Chunk> chunks,
+                       std::string traffic_class = "",
+                       std::string partition = "");
+
+  // Records a notable change during the run such as a new concurrency level.
+  void NotifyEvent(std::string name, int64_t value, std::string detail = "");
+
+  void NotifyChannelSetup(ChannelSetup setup);
+
+  // Records a sample of the RSS of the process in bytes. Samples are kept
+  // apart from events since there are many of them.
+  void NotifyRssSample(int64_t rss);
+
+  // Takes in operations and events recorded by another watcher. Operations
+  // are kept in the order of completion so that warmups stay the first ones.
+  void Merge(const RunnerWatcher& other);
 
   std::vector<Operation> GetNonWarmupsOperations() const;
 
+  // Returns bytes of all operations including warmups.
+  int64_t GetTotalBytes() const;
+
+  std::vector<Event> GetEvents() const;
+
+  std::vector<ChannelSetup> GetChannelSetups() const;
+
+  std::vector<int64_t> GetRssSamples() const;
+
   absl::Duration GetNonWarmupsDuration() const;
 
  private:
@@ -72,6 +129,9 @@ class RunnerWatcher {
   absl::Time start_time_;
   absl::Duration duration_;
   std::vector<Operation> operations_;
+  std::vector<Event> events_;
+  std::vector<ChannelSetup> channel_setups_;
+  std::vector<int64_t> rss_samples_;
   mutable absl::Mutex lock_;
 };
 
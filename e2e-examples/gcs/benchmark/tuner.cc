@@ -0,0 +1,388 @@
+// Copyright 2026 gRPC authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tuner.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "channel_creator.h"
+#include "grpc_runner.h"
+#include "print_result.h"
+#include "runner_watcher.h"
+
+namespace {
+
+constexpr double kMB = 1024.0 * 1024.0;
+
+// Two-sided 95% quantiles of Student's t-distribution for 1 to 30 degrees
+// of freedom.
+constexpr double kStudentT95[] = {
+    12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+    2.201,  2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+    2.080,  2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+
+double GetStudentT95(size_t degrees_of_freedom) {
+  if (degrees_of_freedom == 0) {
+    return 0;
+  }
+  if (degrees_of_freedom > sizeof(kStudentT95) / sizeof(kStudentT95[0])) {
+    return 1.960;
+  }
+  return kStudentT95[degrees_of_freedom - 1];
+}
+
+// Hands out channels created by earlier trials before creating new ones
+// so that trials don't pay for connection setup again.
+class ChannelCache {
+ public:
+  explicit ChannelCache(
+      std::function<std::shared_ptr<grpc::Channel>()> channel_creator)
+      : channel_creator_(channel_creator) {}
+
+  void Rewind() {
+    absl::MutexLock l(&lock_);
+    cursor_ = 0;
+  }
+
+  std::shared_ptr<grpc::Channel> Get() {
+    absl::MutexLock l(&lock_);
+    if (cursor_ == channels_.size()) {
+      channels_.push_back(channel_creator_());
+    }
+    return channels_[cursor_++];
+  }
+
+ private:
+  absl::Mutex lock_;
+  std::function<std::shared_ptr<grpc::Channel>()> channel_creator_;
+  std::vector<std::shared_ptr<grpc::Channel>> channels_;
+  size_t cursor_ = 0;
+};
+
+// Channel policies which don't use carg.
+bool IgnoresChannelArg(const std::string& cpolicy) {
+  return cpolicy == "perthread" || cpolicy == "percall" || cpolicy == "const";
+}
+
+// A configuration is a list of indexes to values of each dimension.
+using Config = std::vector<size_t>;
+
+class SearchSpace {
+ public:
+  explicit SearchSpace(const Parameters& base) : base_(base) {
+    threads_ = base.tune_threads.empty() ? std::vector<int>{base.threads}
+                                         : base.tune_threads;
+    cpolicy_ = base.tune_cpolicy.empty()
+                   ? std::vector<std::string>{base.cpolicy}
+                   : base.tune_cpolicy;
+    carg_ = base.tune_carg.empty() ? std::vector<int>{base.carg}
+                                   : base.tune_carg;
+    chunk_size_ = base.tune_chunk_size.empty()
+                      ? std::vector<int64_t>{base.chunk_size}
+                      : base.tune_chunk_size;
+    tx_zerocopy_ = base.tune_tx_zerocopy.empty()
+                       ? std::vector<bool>{base.tx_zerocopy}
+                       : base.tune_tx_zerocopy;
+    channel_args_ = base.tune_channel_args.empty()
+                        ? std::vector<ChannelArgsProfile>{base.channel_args}
+                        : base.tune_channel_args;
+    sizes_ = {threads_.size(),     cpolicy_.size(),     carg_.size(),
+              chunk_size_.size(),  tx_zerocopy_.size(), channel_args_.size()};
+  }
+
+  const std::vector<size_t>& GetSizes() const { return sizes_; }
+
+  // Returns the canonical form of the configuration or an empty one if it's
+  // not valid. Configurations whose policy ignores carg are collapsed into
+  // the one with the first carg.
+  Config Canonicalize(Config config) const {
+    const std::string& cpolicy = cpolicy_[config[1]];
+    if (IgnoresChannelArg(cpolicy)) {
+      config[2] = 0;
+    } else if (carg_[config[2]] <= 0) {
+      return {};
+    }
+    return config;
+  }
+
+  // Returns all valid configurations.
+  std::vector<Config> GetAll() const {
+    std::vector<Config> configs;
+    Config config(sizes_.size(), 0);
+    while (true) {
+      Config c = Canonicalize(config);
+      if (!c.empty() && c == config) {
+        configs.push_back(c);
+      }
+      // Increments the index like an odometer.
+      size_t d = 0;
+      for (; d < sizes_.size(); d++) {
+        if (++config[d] < sizes_[d]) break;
+        config[d] = 0;
+      }
+      if (d == sizes_.size()) break;
+    }
+    return configs;
+  }
+
+  // Returns valid configurations differing from the given one by a single
+  // step of one dimension.
+  std::vector<Config> GetNeighbors(const Config& config) const {
+    std::vector<Config> neighbors;
+    for (size_t d = 0; d < sizes_.size(); d++) {
+      for (int delta : {-1, 1}) {
+        if ((delta < 0 && config[d] == 0) ||
+            (delta > 0 && config[d] + 1 >= sizes_[d])) {
+          continue;
+        }
+        Config n = config;
+        n[d] += delta;
+        n = Canonicalize(n);
+        if (!n.empty() && n != config) {
+          neighbors.push_back(n);
+        }
+      }
+    }
+    return neighbors;
+  }
+
+  Parameters Apply(const Config& config) const {
+    Parameters p = base_;
+    p.threads = threads_[config[0]];
+    p.cpolicy = cpolicy_[config[1]];
+    p.carg = carg_[config[2]];
+    p.chunk_size = chunk_size_[config[3]];
+    p.tx_zerocopy = tx_zerocopy_[config[4]];
+    p.channel_args = channel_args_[config[5]];
+    return p;
+  }
+
+  std::string ToString(const Config& config) const {
+    Parameters p = Apply(config);
+    return absl::StrFormat(
+        "threads=%d cpolicy=%s carg=%s chunk_size=%d tx_zerocopy=%s "
+        "channel_args=%s",
+        p.threads, p.cpolicy,
+        IgnoresChannelArg(p.cpolicy) ? "-" : std::to_string(p.carg),
+        p.chunk_size, p.tx_zerocopy ? "true" : "false",
+        p.channel_args.name.empty() ? "-" : p.channel_args.name);
+  }
+
+ private:
+  Parameters base_;
+  std::vector<int> threads_;
+  std::vector<std::string> cpolicy_;
+  std::vector<int> carg_;
+  std::vector<int64_t> chunk_size_;
+  std::vector<bool> tx_zerocopy_;
+  std::vector<ChannelArgsProfile> channel_args_;
+  std::vector<size_t> sizes_;
+};
+
+struct TrialResult {
+  Config config;
+  std::vector<double> throughputs;
+  int failures = 0;
+  double mean = 0;
+  double ci = 0;
+};
+
+class Tuner {
+ public:
+  explicit Tuner(const Parameters& parameters)
+      : parameters_(parameters), space_(parameters) {}
+
+  bool Run() {
+    std::vector<Config> all = space_.GetAll();
+    if (all.empty()) {
+      std::cerr << "No valid configuration to tune." << std::endl;
+      return false;
+    }
+    std::mt19937 gen(std::random_device{}());
+    if (parameters_.tune == "grid") {
+      for (const auto& config : all) {
+        Evaluate(config);
+      }
+    } else if (parameters_.tune == "random") {
+      std::shuffle(all.begin(), all.end(), gen);
+      all.resize(std::min(all.size(), size_t(parameters_.tune_trials)));
+      for (const auto& config : all) {
+        Evaluate(config);
+      }
+    } else if (parameters_.tune == "local") {
+      // Explores random configurations with half of the budget and then
+      // spends the rest on neighbors of the best configuration found.
+      std::shuffle(all.begin(), all.end(), gen);
+      size_t explore = std::min(
+          all.size(), size_t(std::max(1, parameters_.tune_trials / 2)));
+      for (size_t i = 0; i < explore; i++) {
+        Evaluate(all[i]);
+      }
+      while (results_.size() < size_t(parameters_.tune_trials)) {
+        auto next = PickNextNeighbor();
+        if (next.empty()) break;
+        Evaluate(next);
+      }
+    }
+    PrintRanking();
+    return true;
+  }
+
+ private:
+  std::vector<TrialResult> GetRanking() const {
+    std::vector<TrialResult> ranking;
+    for (const auto& r : results_) {
+      ranking.push_back(r.second);
+    }
+    std::sort(ranking.begin(), ranking.end(),
+              [](const TrialResult& a, const TrialResult& b) {
+                return a.mean > b.mean;
+              });
+    return ranking;
+  }
+
+  // Returns the first untried neighbor of the best configurations.
+  Config PickNextNeighbor() const {
+    for (const auto& r : GetRanking()) {
+      for (const auto& n : space_.GetNeighbors(r.config)) {
+        if (results_.find(n) == results_.end()) {
+          return n;
+        }
+      }
+    }
+    return {};
+  }
+
+  void Evaluate(const Config& config) {
+    TrialResult result;
+    result.config = config;
+    Parameters p = space_.Apply(config);
+    // A failed run should fail the trial rather than the whole process.
+    p.wait_threads = true;
+    for (int i = 0; i < parameters_.tune_repeats; i++) {
+      double throughput = RunTrial(p, config);
+      if (throughput < 0) {
+        result.failures += 1;
+      } else {
+        result.throughputs.push_back(throughput);
+      }
+    }
+    size_t n = result.throughputs.size();
+    if (n > 0) {
+      double sum = 0;
+      for (double t : result.throughputs) sum += t;
+      result.mean = sum / n;
+      double var = 0;
+      for (double t : result.throughputs) {
+        var += (t - result.mean) * (t - result.mean);
+      }
+      if (n > 1) {
+        result.ci = GetStudentT95(n - 1) * std::sqrt(var / (n - 1) / n);
+      }
+    }
+    std::cout << absl::StrFormat(
+                     "### Trial %d: %s -> %.2fMB/s (+/- %.2f, %d failed)",
+                     results_.size() + 1, space_.ToString(config),
+                     result.mean / kMB, result.ci / kMB, result.failures)
+              << std::endl;
+    results_[config] = std::move(result);
+  }
+
+  // Runs the configuration once and returns its throughput or -1 if failed.
+  double RunTrial(const Parameters& p, const Config& config) {
+    std::function<std::shared_ptr<grpc::Channel>()> channel_creator;
+    // dpool probes fresh channels for distinct peers, which reused ones
+    // would defeat.
+    if (p.cpolicy != "percall" && p.cpolicy != "dpool") {
+      ChannelCache* cache = GetChannelCache(p);
+      cache->Rewind();
+      channel_creator = [cache]() { return cache->Get(); };
+    }
+    auto watcher = std::make_shared<RunnerWatcher>(p.warmups * p.threads);
+    GrpcRunner runner(p, watcher, channel_creator);
+    absl::Time run_start = absl::Now();
+    watcher->SetStartTime(run_start);
+    if (!runner.Run()) {
+      return -1;
+    }
+    watcher->SetDuration(absl::Now() - run_start);
+    if (!parameters_.report_file.empty()) {
+      WriteReport(*watcher, parameters_.report_file,
+                  absl::StrCat(parameters_.report_tag, " ",
+                               space_.ToString(config)));
+    }
+    int64_t total_bytes = 0;
+    for (const auto& op : watcher->GetNonWarmupsOperations()) {
+      total_bytes += op.bytes;
+    }
+    double elapsed = absl::ToDoubleSeconds(watcher->GetNonWarmupsDuration());
+    return elapsed > 0 ? total_bytes / elapsed : 0;
+  }
+
+  // Channels are shared across trials having the same channel arguments.
+  ChannelCache* GetChannelCache(const Parameters& p) {
+    std::string key = absl::StrCat("tx_zerocopy=", p.tx_zerocopy,
+                                   " channel_args=", p.channel_args.name);
+    auto& cache = channel_caches_[key];
+    if (cache == nullptr) {
+      cache = std::make_unique<ChannelCache>([p]() {
+        return CreateGrpcChannel(p.host, p.access_token, p.network, p.cred,
+                                 p.ssl_cert, p.rr, p.wrr, p.td, p.tx_zerocopy,
+                                 p.cache_credentials, p.ssl_session_cache,
+                                 p.compression, p.channel_args);
+      });
+    }
+    return cache.get();
+  }
+
+  void PrintRanking() const {
+    std::cout << std::endl << "Tuning result" << std::endl;
+    std::cout << absl::StrFormat(" %4s %12s %12s %4s %6s  %s", "Rank",
+                                 "Mean(MB/s)", "95%CI(MB/s)", "Runs", "Failed",
+                                 "Configuration")
+              << std::endl;
+    int rank = 0;
+    for (const auto& r : GetRanking()) {
+      std::cout << absl::StrFormat(" %4d %12.2f %12.2f %4d %6d  %s", ++rank,
+                                   r.mean / kMB, r.ci / kMB,
+                                   r.throughputs.size(), r.failures,
+                                   space_.ToString(r.config))
+                << std::endl;
+    }
+  }
+
+ private:
+  Parameters parameters_;
+  SearchSpace space_;
+  std::map<Config, TrialResult> results_;
+  std::map<std::string, std::unique_ptr<ChannelCache>> channel_caches_;
+};
+
+}  // namespace
+
+bool RunTuner(const Parameters& parameters) {
+  Tuner tuner(parameters);
+  return tuner.Run();
+}
@@ -0,0 +1,25 @@
+// Copyright 2026 gRPC authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef GCS_BENCHMARK_TUNER_H_
+#define GCS_BENCHMARK_TUNER_H_
+
+#include "parameters.h"
+
+// Runs short trials of the grpc runner over the search space given by
+// tune_* parameters and prints configurations ranked by throughput.
+// Parameters not in the search space are shared by all trials.
+bool RunTuner(const Parameters& parameters);
+
+#endif  // GCS_BENCHMARK_TUNER_H_
@@ -15,38 +15,75 @@
 #include "work_queue.h"
 
 WorkQueue::WorkQueue(int thread_count, int work_count_per_thread,
-                     bool work_stealing_enabled)
-    : thread_count_(thread_count),
+                     bool work_stealing_enabled, int first_thread_id)
+    : first_thread_id_(first_thread_id),
+      thread_count_(thread_count),
       work_count_per_thread_(work_count_per_thread),
       work_stealing_enabled_(work_stealing_enabled) {
   thread_works_.assign(thread_count, 0);
 }
 
 std::tuple<int, int> WorkQueue::pop(int thread_id) {
-  if (thread_id < 1 || thread_id > thread_count_) {
+  if (thread_id < first_thread_id_ ||
+      thread_id >= first_thread_id_ + thread_count_) {
     return std::make_tuple(0, 0);
   }
 
-  absl::MutexLock l(&mu_);
+  std::vector<std::weak_ptr<WorkQueue>> neighbors;
+  {
+    absl::MutexLock l(&mu_);
 
-  // Pop the next work if the current thread still has remaining works
-  int& cur_thread_work = thread_works_[thread_id - 1];
-  if (cur_thread_work < work_count_per_thread_) {
-    cur_thread_work += 1;
-    return std::make_tuple(thread_id, cur_thread_work);
-  }
+    // Pop the next work if the current thread still has remaining works
+    int& cur_thread_work = thread_works_[thread_id - first_thread_id_];
+    if (cur_thread_work < work_count_per_thread_) {
+      cur_thread_work += 1;
+      return std::make_tuple(thread_id, cur_thread_work);
+    }
 
-  // Try to steal a job from other threads if it's enabled
-  if (work_stealing_enabled_) {
-    for (int t = 0; t < thread_count_; t++) {
-      int& t_work = thread_works_[t];
-      if (t_work < work_count_per_thread_) {
-        t_work += 1;
-        return std::make_tuple(t + 1, t_work);
+    // Try to steal a job from other threads if it's enabled
+    if (work_stealing_enabled_) {
+      auto work = StealLocked();
+      if (std::get<0>(work) != 0) {
+        return work;
       }
     }
+    neighbors = neighbors_;
+  }
+
+  // Spill over to neighbors once this queue runs dry
+  for (const auto& n : neighbors) {
+    auto neighbor = n.lock();
+    if (neighbor == nullptr) {
+      continue;
+    }
+    auto work = neighbor->steal();
+    if (std::get<0>(work) != 0) {
+      return work;
+    }
   }
 
   // Otherwise nothing to do
   return std::make_tuple(0, 0);
 }
+
+std::tuple<int, int> WorkQueue::steal() {
+  absl::MutexLock l(&mu_);
+  return StealLocked();
+}
+
+void WorkQueue::set_neighbors(
+    std::vector<std::shared_ptr<WorkQueue>> neighbors) {
+  absl::MutexLock l(&mu_);
+  neighbors_.assign(neighbors.begin(), neighbors.end());
+}
+
+std::tuple<int, int> WorkQueue::StealLocked() {
+  for (int t = 0; t < thread_count_; t++) {
+    int& t_work = thread_works_[t];
+    if (t_work < work_count_per_thread_) {
+      t_work += 1;
+      return std::make_tuple(first_thread_id_ + t, t_work);
+    }
+  }
+  return std::make_tuple(0, 0);
+}
@@ -15,6 +15,7 @@
 #ifndef GCS_BENCHMARK_WORK_QUEUE_H_
 #define GCS_BENCHMARK_WORK_QUEUE_H_
 
+#include <memory>
 #include <tuple>
 #include <vector>
 
@@ -22,19 +23,32 @@
 
 class WorkQueue {
  public:
+  // Threads are numbered from first_thread_id so that queues of shards can
+  // cover different ranges of threads.
   WorkQueue(int thread_count, int work_count_per_thread,
-            bool work_stealing_enabled);
+            bool work_stealing_enabled, int first_thread_id = 1);
 
   // Returns tuple<thread_id, work_id> if there is job.
   // Otherwise it returns tuple<0, 0>
   std::tuple<int, int> pop(int thread_id);
 
+  // Takes a job of any thread in this queue. Returns tuple<0, 0> if none.
+  std::tuple<int, int> steal();
+
+  // Sets queues to take jobs from once this queue runs out of them.
+  void set_neighbors(std::vector<std::shared_ptr<WorkQueue>> neighbors);
+
+ private:
+  std::tuple<int, int> StealLocked() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
  private:
   absl::Mutex mu_;
+  int first_thread_id_;
   int thread_count_;
   int work_count_per_thread_;
   bool work_stealing_enabled_;
   std::vector<int> thread_works_;
+  std::vector<std::weak_ptr<WorkQueue>> neighbors_;
 };
 
 #endif  // GCS_BENCHMARK_WORK_QUEUE_H_
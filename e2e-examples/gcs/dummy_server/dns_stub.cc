@@ -0,0 +1,207 @@
+// Copyright 2026 gRPC authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dns_stub.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <iostream>
+
+#include "absl/strings/ascii.h"
+#include "absl/strings/match.h"
+
+namespace {
+
+constexpr uint16_t kTypeA = 1;
+constexpr uint16_t kTypeSrv = 33;
+constexpr uint16_t kClassIn = 1;
+constexpr uint32_t kTtlSeconds = 1;
+// Name of the balancer in SRV answers. Its A query gets the loopback.
+constexpr char kBalancerName[] = "grpclb.dummy-server.local";
+
+void AppendUint16(std::string* out, uint16_t v) {
+  out->push_back(static_cast<char>(v >> 8));
+  out->push_back(static_cast<char>(v & 0xff));
+}
+
+void AppendUint32(std::string* out, uint32_t v) {
+  AppendUint16(out, static_cast<uint16_t>(v >> 16));
+  AppendUint16(out, static_cast<uint16_t>(v & 0xffff));
+}
+
+uint16_t ReadUint16(const std::string& in, size_t offset) {
+  return static_cast<uint16_t>(
+      (static_cast<unsigned char>(in[offset]) << 8) |
+      static_cast<unsigned char>(in[offset + 1]));
+}
+
+void AppendName(std::string* out, const std::string& name) {
+  size_t start = 0;
+  while (start < name.size()) {
+    size_t end = name.find('.', start);
+    if (end == std::string::npos) {
+      end = name.size();
+    }
+    out->push_back(static_cast<char>(end - start));
+    out->append(name, start, end - start);
+    start = end + 1;
+  }
+  out->push_back(0);
+}
+
+// Reads the uncompressed name of the question. Returns the offset after it
+// or 0 if it's malformed.
+size_t ReadName(const std::string& in, size_t offset, std::string* name) {
+  while (offset < in.size()) {
+    size_t len = static_cast<unsigned char>(in[offset]);
+    offset += 1;
+    if (len == 0) {
+      return offset;
+    }
+    if (len > 63 || offset + len > in.size()) {
+      return 0;
+    }
+    if (!name->empty()) {
+      name->push_back('.');
+    }
+    name->append(in, offset, len);
+    offset += len;
+  }
+  return 0;
+}
+
+// Appends the header of an answer which refers to the name of the question.
+void AppendAnswerHeader(std::string* out, uint16_t type, uint16_t length) {
+  AppendUint16(out, 0xc00c);
+  AppendUint16(out, type);
+  AppendUint16(out, kClassIn);
+  AppendUint32(out, kTtlSeconds);
+  AppendUint16(out, length);
+}
+
+}  // namespace
+
+DnsStub::DnsStub(std::vector<std::string> backend_ips, int balancer_port)
+    : backend_ips_(std::move(backend_ips)), balancer_port_(balancer_port) {}
+
+DnsStub::~DnsStub() {
+  shutdown_ = true;
+  if (thread_ != nullptr) {
+    thread_->join();
+  }
+  if (socket_ >= 0) {
+    close(socket_);
+  }
+}
+
+bool DnsStub::Start(int port) {
+  socket_ = socket(AF_INET, SOCK_DGRAM, 0);
+  if (socket_ < 0) {
+    return false;
+  }
+  // Wakes up now and then to see if it's shutting down.
+  struct timeval timeout = {0, 200000};
+  setsockopt(socket_, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (bind(socket_, reinterpret_cast<struct sockaddr*>(&addr),
+           sizeof(addr)) != 0) {
+    return false;
+  }
+  thread_ = std::unique_ptr<std::thread>(
+      new std::thread([this]() { this->ThreadRun(); }));
+  return true;
+}
+
+void DnsStub::ThreadRun() {
+  char buf[512];
+  while (!shutdown_) {
+    struct sockaddr_storage peer;
+    socklen_t peer_len = sizeof(peer);
+    ssize_t n = recvfrom(socket_, buf, sizeof(buf), 0,
+                         reinterpret_cast<struct sockaddr*>(&peer), &peer_len);
+    if (n <= 0) {
+      continue;
+    }
+    std::string response = Answer(std::string(buf, n));
+    if (!response.empty()) {
+      sendto(socket_, response.data(), response.size(), 0,
+             reinterpret_cast<struct sockaddr*>(&peer), peer_len);
+    }
+  }
+}
+
+std::string DnsStub::Answer(const std::string& query) {
+  // Header is 12 bytes and followed by a single question.
+  if (query.size() < 12 || ReadUint16(query, 4) != 1) {
+    return "";
+  }
+  std::string name;
+  size_t offset = ReadName(query, 12, &name);
+  if (offset == 0 || offset + 4 > query.size()) {
+    return "";
+  }
+  const uint16_t type = ReadUint16(query, offset);
+  const std::string question = query.substr(12, offset + 4 - 12);
+  name = absl::AsciiStrToLower(name);
+
+  std::string answers;
+  uint16_t answer_count = 0;
+  if (type == kTypeA && name == kBalancerName) {
+    AppendAnswerHeader(&answers, kTypeA, 4);
+    AppendUint32(&answers, INADDR_LOOPBACK);
+    answer_count = 1;
+  } else if (type == kTypeA) {
+    size_t rotation = next_rotation_++;
+    for (size_t i = 0; i < backend_ips_.size(); i++) {
+      const std::string& ip =
+          backend_ips_[(rotation + i) % backend_ips_.size()];
+      struct in_addr addr;
+      if (inet_pton(AF_INET, ip.c_str(), &addr) != 1) {
+        continue;
+      }
+      AppendAnswerHeader(&answers, kTypeA, 4);
+      answers.append(reinterpret_cast<const char*>(&addr), 4);
+      answer_count += 1;
+    }
+  } else if (type == kTypeSrv && balancer_port_ > 0 &&
+             absl::StartsWith(name, "_grpclb._tcp.")) {
+    std::string target;
+    AppendName(&target, kBalancerName);
+    AppendAnswerHeader(&answers, kTypeSrv, 6 + target.size());
+    AppendUint16(&answers, 0);  // priority
+    AppendUint16(&answers, 0);  // weight
+    AppendUint16(&answers, balancer_port_);
+    answers.append(target);
+    answer_count = 1;
+  }
+
+  std::string response;
+  response.append(query, 0, 2);  // id
+  // Response, authoritative, recursion desired and available, no error
+  AppendUint16(&response, 0x8580);
+  AppendUint16(&response, 1);
+  AppendUint16(&response, answer_count);
+  AppendUint16(&response, 0);
+  AppendUint16(&response, 0);
+  response.append(question);
+  response.append(answers);
+  return response;
+}
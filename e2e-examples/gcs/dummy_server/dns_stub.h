@@ -0,0 +1,51 @@
+// Copyright 2026 gRPC authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef GCS_BENCHMARK_DUMMY_SERVER_DNS_STUB_H_
+#define GCS_BENCHMARK_DUMMY_SERVER_DNS_STUB_H_
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Minimal DNS server on localhost UDP so that channels can resolve a fake
+// name to local backends and find a grpclb balancer without the network.
+// A queries of any name get all backend addresses, rotated by one for every
+// query like DNS round robin. SRV queries of _grpclb._tcp.<name> point to
+// the balancer when it's given. Other queries get no answer.
+class DnsStub {
+ public:
+  // backend_ips are IPv4 addresses. balancer_port of 0 means no balancer.
+  DnsStub(std::vector<std::string> backend_ips, int balancer_port);
+  ~DnsStub();
+
+  // Starts serving on 127.0.0.1:port. Returns false if it cannot bind.
+  bool Start(int port);
+
+ private:
+  void ThreadRun();
+  std::string Answer(const std::string& query);
+
+ private:
+  std::vector<std::string> backend_ips_;
+  int balancer_port_;
+  int socket_ = -1;
+  std::atomic<bool> shutdown_{false};
+  std::unique_ptr<std::thread> thread_;
+  size_t next_rotation_ = 0;
+};
+
+#endif  // GCS_BENCHMARK_DUMMY_SERVER_DNS_STUB_H_
@@ -0,0 +1,91 @@
+// Copyright 2026 gRPC authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "grpclb_balancer.h"
+
+#include <arpa/inet.h>
+
+#include "absl/strings/numbers.h"
+
+using grpc::lb::v1::LoadBalanceRequest;
+using grpc::lb::v1::LoadBalanceResponse;
+
+GrpclbBalancerImpl::GrpclbBalancerImpl(std::vector<std::string> backends)
+    : backends_(std::move(backends)) {}
+
+LoadBalanceResponse GrpclbBalancerImpl::GetServerList() {
+  LoadBalanceResponse response;
+  auto* server_list = response.mutable_server_list();
+  size_t rotation = next_rotation_++;
+  for (size_t i = 0; i < backends_.size(); i++) {
+    const std::string& backend = backends_[(rotation + i) % backends_.size()];
+    size_t colon = backend.rfind(':');
+    struct in_addr addr;
+    int port;
+    if (colon == std::string::npos ||
+        inet_pton(AF_INET, backend.substr(0, colon).c_str(), &addr) != 1 ||
+        !absl::SimpleAtoi(backend.substr(colon + 1), &port)) {
+      continue;
+    }
+    auto* server = server_list->add_servers();
+    server->set_ip_address(std::string(reinterpret_cast<char*>(&addr), 4));
+    server->set_port(port);
+    server->set_load_balance_token("dummy");
+  }
+  return response;
+}
+
+grpc::ServerBidiReactor<LoadBalanceRequest, LoadBalanceResponse>*
+GrpclbBalancerImpl::BalanceLoad(grpc::CallbackServerContext* /*context*/) {
+  // Answers the initial request with the initial response and the server
+  // list, then keeps reading load reports until the client goes away.
+  class Reactor : public grpc::ServerBidiReactor<LoadBalanceRequest,
+                                                 LoadBalanceResponse> {
+   public:
+    explicit Reactor(LoadBalanceResponse server_list)
+        : server_list_(std::move(server_list)) {
+      initial_.mutable_initial_response();
+      StartRead(&request_);
+    }
+
+    void OnReadDone(bool ok) override {
+      if (!ok) {
+        Finish(grpc::Status::OK);
+        return;
+      }
+      if (!started_) {
+        started_ = true;
+        StartWrite(&initial_);
+      }
+      StartRead(&request_);
+    }
+
+    void OnWriteDone(bool ok) override {
+      if (ok && !list_sent_) {
+        list_sent_ = true;
+        StartWrite(&server_list_);
+      }
+    }
+
+    void OnDone() override { delete this; }
+
+   private:
+    LoadBalanceRequest request_;
+    LoadBalanceResponse initial_;
+    LoadBalanceResponse server_list_;
+    bool started_ = false;
+    bool list_sent_ = false;
+  };
+  return new Reactor(GetServerList());
+}
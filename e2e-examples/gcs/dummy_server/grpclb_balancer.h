@@ -0,0 +1,46 @@
+// Copyright 2026 gRPC authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef GCS_BENCHMARK_DUMMY_SERVER_GRPCLB_BALANCER_H_
+#define GCS_BENCHMARK_DUMMY_SERVER_GRPCLB_BALANCER_H_
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "src/proto/grpc/lb/v1/load_balancer.grpc.pb.h"
+
+// Minimal grpclb balancer handing out a fixed list of backends. Every
+// client stream gets the list rotated by one more than the previous stream
+// so that pick_first channels spread over backends. Client load reports are
+// read and dropped.
+class GrpclbBalancerImpl final
+    : public grpc::lb::v1::LoadBalancer::CallbackService {
+ public:
+  // backends are IPv4 addresses with ports (e.g. 127.0.0.2:50051).
+  explicit GrpclbBalancerImpl(std::vector<std::string> backends);
+
+  grpc::ServerBidiReactor<grpc::lb::v1::LoadBalanceRequest,
+                          grpc::lb::v1::LoadBalanceResponse>*
+  BalanceLoad(grpc::CallbackServerContext* context) override;
+
+ private:
+  grpc::lb::v1::LoadBalanceResponse GetServerList();
+
+ private:
+  std::vector<std::string> backends_;
+  std::atomic<size_t> next_rotation_{0};
+};
+
+#endif  // GCS_BENCHMARK_DUMMY_SERVER_GRPCLB_BALANCER_H_
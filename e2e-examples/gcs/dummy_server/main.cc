@@ -12,141 +12,68 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <stdio.h>
+
 #include <grpcpp/ext/proto_server_reflection_plugin.h>
 #include <grpcpp/grpcpp.h>
 #include <grpcpp/health_check_service_interface.h>
 
-#include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "absl/flags/flag.h"
 #include "absl/flags/parse.h"
+#include "absl/strings/numbers.h"
 #include "absl/strings/str_format.h"
-#include "e2e-examples/gcs/dummy_server/gcs_util.h"
-#include "google/storage/v2/storage.grpc.pb.h"
+#include "absl/strings/str_split.h"
+#include "absl/time/time.h"
+#include "e2e-examples/gcs/dummy_server/dns_stub.h"
+#include "e2e-examples/gcs/dummy_server/grpclb_balancer.h"
+#include "e2e-examples/gcs/dummy_server/storage_service.h"
+#include "e2e-examples/gcs/dummy_server/xds_server.h"
 
-using grpc::CallbackServerContext;
 using grpc::Server;
 using grpc::ServerBuilder;
-using grpc::ServerUnaryReactor;
-using grpc::Status;
-using grpc::StatusCode;
-
-using ::google::storage::v2::GetObjectRequest;
-using ::google::storage::v2::Object;
-using ::google::storage::v2::ReadObjectRequest;
-using ::google::storage::v2::ReadObjectResponse;
-using ::google::storage::v2::StartResumableWriteRequest;
-using ::google::storage::v2::StartResumableWriteResponse;
-using ::google::storage::v2::WriteObjectRequest;
-using ::google::storage::v2::WriteObjectResponse;
 
 ABSL_FLAG(uint16_t, port, 50051, "Server port for the service");
+ABSL_FLAG(std::string, uds, "",
+          "Path of the Unix domain socket to listen on instead of the port");
+ABSL_FLAG(int, backends, 1,
+          "Number of backends to run. Backends listen on the port of "
+          "127.0.0.1, 127.0.0.2 and so on when there are more than one");
+ABSL_FLAG(int, grpclb_port, 0,
+          "Port of the grpclb balancer handing out the backends, which "
+          "listens with insecure credentials (0 to disable)");
+ABSL_FLAG(int, dns_port, 0,
+          "UDP port of the DNS stub resolving any name to the backends and "
+          "the grpclb balancer (0 to disable)");
+ABSL_FLAG(int, xds_port, 0,
+          "Port of the local xDS server handing out the backends (0 to "
+          "disable)");
+ABSL_FLAG(std::string, xds_locality_weights, "1",
+          "Comma-separated weights of xDS localities. Backends are spread "
+          "over the localities in turn");
+ABSL_FLAG(absl::Duration, xds_update_interval, absl::ZeroDuration(),
+          "Interval at which the xDS server pushes a new version of the "
+          "endpoints with rotated weights and backends (0 for never)");
 ABSL_FLAG(std::string, cred, "insecure", "Credential type (insecure,ssl,alts)");
 ABSL_FLAG(std::string, ssl_key, "", "Path to the server private key file");
 ABSL_FLAG(std::string, ssl_cert, "",
           "Path to the server SSL certification chain file");
-
-// Logic and data behind the server's behavior.
-class StorageServiceImpl final
-    : public google::storage::v2::Storage::CallbackService {
-  ServerUnaryReactor* GetObject(CallbackServerContext* context,
-                                const GetObjectRequest* request,
-                                Object* reply) override {
-    Status status;
-    const int64_t object_size =
-        GcsUtil::GetObjectSize(request->bucket(), request->object());
-    if (object_size < 0) {
-      status = Status(StatusCode::NOT_FOUND, "Object is not found");
-    } else {
-      status = Status::OK;
-      reply->set_size(object_size);
-    }
-    ServerUnaryReactor* reactor = context->DefaultReactor();
-    reactor->Finish(status);
-    return reactor;
-  }
-
-  grpc::ServerWriteReactor<ReadObjectResponse>* ReadObject(
-      CallbackServerContext* context,
-      const ReadObjectRequest* request) override {
-    class Reactor : public grpc::ServerWriteReactor<ReadObjectResponse> {
-     public:
-      Reactor(const ReadObjectRequest* request) {
-        const int64_t object_size =
-            GcsUtil::GetObjectSize(request->bucket(), request->object());
-        if (object_size < 0) {
-          Finish(Status(StatusCode::NOT_FOUND, "Object is not found"));
-          return;
-        }
-        left_size_ = object_size;
-        if (request->read_limit() > 0) {
-          left_size_ = std::min(left_size_, request->read_limit());
-        }
-        chunk_data_ = absl::Cord(GcsUtil::GetObjectDataChunk(
-            google::storage::v2::ServiceConstants::MAX_READ_CHUNK_BYTES));
-        MaybeWriteNext();
-      }
-
-      void OnWriteDone(bool ok) override {
-        if (ok) {
-          MaybeWriteNext();
-        } else {
-          Finish(grpc::Status(grpc::StatusCode::UNKNOWN, "Unexpected failure"));
-        }
-      }
-
-      void OnDone() override { delete this; }
-
-     private:
-      void MaybeWriteNext() {
-        if (left_size_ == 0) {
-          Finish(grpc::Status::OK);
-          return;
-        }
-        auto data_size =
-            std::min(left_size_, static_cast<int64_t>(chunk_data_.size()));
-        response_.mutable_checksummed_data()->set_content(
-            chunk_data_.Subcord(0, data_size));
-        left_size_ -= data_size;
-        StartWrite(&response_);
-      }
-
-     private:
-      int64_t left_size_;
-      absl::Cord chunk_data_;
-      ReadObjectResponse response_;
-    };
-
-    return new Reactor(request);
-  }
-
-  grpc::ServerReadReactor<WriteObjectRequest>* WriteObject(
-      CallbackServerContext* context, WriteObjectResponse* response) override {
-    class Reactor : public grpc::ServerReadReactor<WriteObjectRequest> {
-     public:
-      explicit Reactor(WriteObjectResponse* response) { StartRead(&request_); }
-
-      void OnReadDone(bool ok) override {
-        if (!ok) {
-          Finish(grpc::Status::OK);
-          return;
-        }
-        StartRead(&request_);
-      }
-
-      void OnDone() override { delete this; }
-
-     private:
-      WriteObjectRequest request_;
-      WriteObjectResponse* response_ = nullptr;
-    };
-    return new Reactor(response);
-  }
-};
+ABSL_FLAG(absl::Duration, read_delay, absl::ZeroDuration(),
+          "Delay before sending each chunk of ReadObject to slow peers");
+ABSL_FLAG(double, slow_peer_ratio, 1.0,
+          "Ratio of peers (client connections) which get read_delay");
+ABSL_FLAG(bool, orca, false,
+          "Attach ORCA load reports to responses for weighted_round_robin");
+ABSL_FLAG(double, orca_cpu_utilization, 0.5,
+          "CPU utilization to report when orca_capacity_qps is not set");
+ABSL_FLAG(double, orca_capacity_qps, 0,
+          "QPS at which this server reports full CPU utilization. Reported "
+          "utilization follows the measured QPS when set");
 
 static std::string LoadStringFromFile(std::string path) {
   std::ifstream file(path);
@@ -159,44 +86,159 @@ static std::string LoadStringFromFile(std::string path) {
   return sstr.str();
 }
 
-void RunServer(uint16_t port) {
-  std::string server_address = absl::StrFormat("0.0.0.0:%d", port);
-
-  grpc::EnableDefaultHealthCheckService(true);
-  grpc::reflection::InitProtoReflectionServerBuilderPlugin();
-
-  ServerBuilder builder;
+// Returns server credentials of the cred flag.
+static std::shared_ptr<grpc::ServerCredentials> GetServerCredentials() {
   const std::string cred = absl::GetFlag(FLAGS_cred);
   if (cred == "insecure") {
-    builder.AddListeningPort(server_address, grpc::InsecureServerCredentials());
+    return grpc::InsecureServerCredentials();
   } else if (cred == "ssl") {
     grpc::SslServerCredentialsOptions::PemKeyCertPair key_cert_pair = {
         LoadStringFromFile(absl::GetFlag(FLAGS_ssl_key)),
         LoadStringFromFile(absl::GetFlag(FLAGS_ssl_cert))};
     grpc::SslServerCredentialsOptions ssl_options;
     ssl_options.pem_key_cert_pairs.emplace_back(key_cert_pair);
-    builder.AddListeningPort(server_address,
-                             grpc::SslServerCredentials(ssl_options));
+    return grpc::SslServerCredentials(ssl_options);
   } else if (cred == "alts") {
     grpc::experimental::AltsServerCredentialsOptions alts_opts;
-    builder.AddListeningPort(
-        server_address, grpc::experimental::AltsServerCredentials(alts_opts));
+    return grpc::experimental::AltsServerCredentials(alts_opts);
   } else {
     std::cout << "Unknown cred type: " << cred << std::endl;
     exit(1);
   }
+}
 
-  StorageServiceImpl service;
-  builder.RegisterService(&service);
-
+// Starts a server of the service listening on the address.
+static std::unique_ptr<Server> StartServer(
+    const std::string& address, grpc::Service* service,
+    std::shared_ptr<grpc::ServerCredentials> credentials, bool orca) {
+  ServerBuilder builder;
+  builder.AddListeningPort(address, credentials);
+  if (orca) {
+    builder.experimental().EnableCallMetricRecording();
+  }
+  builder.RegisterService(service);
   std::unique_ptr<Server> server(builder.BuildAndStart());
-  std::cout << "Server listening on " << server_address << std::endl;
+  if (server == nullptr) {
+    std::cout << "Failed to listen on " << address << std::endl;
+    exit(1);
+  }
+  std::cout << "Server listening on " << address << std::endl;
+  return server;
+}
+
+void RunServer(uint16_t port, std::string uds) {
+  grpc::EnableDefaultHealthCheckService(true);
+  grpc::reflection::InitProtoReflectionServerBuilderPlugin();
+
+  // Multiple backends listen on their own loopback addresses with the same
+  // port so that DNS answers, which carry no port, can tell them apart.
+  const int backends = absl::GetFlag(FLAGS_backends);
+  std::vector<std::string> server_addresses;
+  std::vector<std::string> backend_ips;
+  if (!uds.empty()) {
+    // A socket file left by an earlier run would make binding fail.
+    remove(uds.c_str());
+    server_addresses.push_back("unix:" + uds);
+  } else if (backends <= 1) {
+    // Listens on both IPv4 and IPv6 when the host supports it.
+    server_addresses.push_back(absl::StrFormat("[::]:%d", port));
+    backend_ips.push_back("127.0.0.1");
+  } else {
+    for (int i = 0; i < backends; i++) {
+      backend_ips.push_back(absl::StrFormat("127.0.0.%d", i + 1));
+      server_addresses.push_back(
+          absl::StrFormat("%s:%d", backend_ips.back(), port));
+    }
+  }
+
+  StorageServiceOptions options;
+  options.read_delay = absl::GetFlag(FLAGS_read_delay);
+  options.slow_peer_ratio = absl::GetFlag(FLAGS_slow_peer_ratio);
+  options.orca = absl::GetFlag(FLAGS_orca);
+  options.orca_cpu_utilization = absl::GetFlag(FLAGS_orca_cpu_utilization);
+  options.orca_capacity_qps = absl::GetFlag(FLAGS_orca_capacity_qps);
+  std::vector<std::unique_ptr<StorageServiceImpl>> services;
+  std::vector<std::unique_ptr<Server>> servers;
+  for (const auto& address : server_addresses) {
+    services.emplace_back(new StorageServiceImpl(options));
+    servers.push_back(StartServer(address, services.back().get(),
+                                  GetServerCredentials(),
+                                  absl::GetFlag(FLAGS_orca)));
+  }
+
+  // The balancer and the DNS stub let grpclb clients find the backends.
+  const int grpclb_port = absl::GetFlag(FLAGS_grpclb_port);
+  std::unique_ptr<GrpclbBalancerImpl> balancer;
+  if (grpclb_port > 0 && !backend_ips.empty()) {
+    std::vector<std::string> backend_addresses;
+    for (const auto& ip : backend_ips) {
+      backend_addresses.push_back(absl::StrFormat("%s:%d", ip, port));
+    }
+    balancer.reset(new GrpclbBalancerImpl(backend_addresses));
+    // The balancer is a plain local service like the xDS server, so it
+    // doesn't take the credentials and the load reports of backends.
+    servers.push_back(StartServer(
+        absl::StrFormat("127.0.0.1:%d", grpclb_port), balancer.get(),
+        grpc::InsecureServerCredentials(), false));
+  }
+  const int dns_port = absl::GetFlag(FLAGS_dns_port);
+  std::unique_ptr<DnsStub> dns_stub;
+  if (dns_port > 0 && !backend_ips.empty()) {
+    dns_stub.reset(new DnsStub(backend_ips, balancer ? grpclb_port : 0));
+    if (!dns_stub->Start(dns_port)) {
+      std::cout << "Failed to start DNS stub on port " << dns_port
+                << std::endl;
+      exit(1);
+    }
+    std::cout << absl::StrFormat(
+                     "DNS stub listening on 127.0.0.1:%d. Clients can use "
+                     "dns://127.0.0.1:%d/storage.dummy:%d as their target",
+                     dns_port, dns_port, port)
+              << std::endl;
+  }
+
+  // The xDS server lets xds clients find the backends.
+  const int xds_port = absl::GetFlag(FLAGS_xds_port);
+  std::unique_ptr<XdsServer> xds_server;
+  if (xds_port > 0 && !backend_ips.empty()) {
+    XdsServerOptions xds_options;
+    xds_options.backend_ips = backend_ips;
+    xds_options.backend_port = port;
+    xds_options.locality_weights.clear();
+    for (absl::string_view w :
+         absl::StrSplit(absl::GetFlag(FLAGS_xds_locality_weights), ',')) {
+      int weight;
+      if (!absl::SimpleAtoi(w, &weight) || weight <= 0) {
+        std::cout << "Invalid xds_locality_weights: " << w << std::endl;
+        exit(1);
+      }
+      xds_options.locality_weights.push_back(weight);
+    }
+    if (xds_options.locality_weights.size() > backend_ips.size()) {
+      std::cout << "xds_locality_weights cannot have more localities than "
+                   "backends"
+                << std::endl;
+      exit(1);
+    }
+    xds_options.update_interval = absl::GetFlag(FLAGS_xds_update_interval);
+    xds_server = XdsServer::Start(xds_port, std::move(xds_options));
+    if (xds_server == nullptr) {
+      std::cout << "Failed to start xDS server on port " << xds_port
+                << std::endl;
+      exit(1);
+    }
+    std::cout << absl::StrFormat(
+                     "xDS server listening on 127.0.0.1:%d. Clients can use "
+                     "xds:///storage.dummy with it in their bootstrap",
+                     xds_port)
+              << std::endl;
+  }
 
-  server->Wait();
+  servers[0]->Wait();
 }
 
 int main(int argc, char** argv) {
   absl::ParseCommandLine(argc, argv);
-  RunServer(absl::GetFlag(FLAGS_port));
+  RunServer(absl::GetFlag(FLAGS_port), absl::GetFlag(FLAGS_uds));
   return 0;
 }
@@ -0,0 +1,200 @@
+// Copyright 2026 gRPC authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "storage_service.h"
+
+#include <grpcpp/alarm.h>
+#include <grpcpp/ext/call_metric_recorder.h>
+
+#include <algorithm>
+#include <functional>
+#include <string>
+
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "gcs_util.h"
+
+using grpc::CallbackServerContext;
+using grpc::ServerUnaryReactor;
+using grpc::Status;
+using grpc::StatusCode;
+
+using ::google::storage::v2::GetObjectRequest;
+using ::google::storage::v2::Object;
+using ::google::storage::v2::ReadObjectRequest;
+using ::google::storage::v2::ReadObjectResponse;
+using ::google::storage::v2::WriteObjectRequest;
+using ::google::storage::v2::WriteObjectResponse;
+
+// Measures calls per second over the last full second.
+class QpsMeter {
+ public:
+  // Counts a call and returns the latest QPS.
+  double Record() {
+    absl::MutexLock l(&lock_);
+    absl::Time now = absl::Now();
+    count_ += 1;
+    absl::Duration elapsed = now - window_start_;
+    if (elapsed >= absl::Seconds(1)) {
+      qps_ = count_ / absl::ToDoubleSeconds(elapsed);
+      count_ = 0;
+      window_start_ = now;
+    }
+    return qps_;
+  }
+
+ private:
+  absl::Mutex lock_;
+  absl::Time window_start_ = absl::Now();
+  int64_t count_ = 0;
+  double qps_ = 0;
+};
+
+StorageServiceImpl::StorageServiceImpl(StorageServiceOptions options)
+    : options_(options), qps_meter_(new QpsMeter()) {}
+
+StorageServiceImpl::~StorageServiceImpl() = default;
+
+// Returns true if the peer is chosen to be slow. Peers are chosen by the hash
+// of their address so that every call of one connection gets the same speed.
+bool StorageServiceImpl::IsSlowPeer(const std::string& peer) const {
+  return std::hash<std::string>()(peer) % 1000 <
+         options_.slow_peer_ratio * 1000;
+}
+
+// Records the backend load of this server to the call so that it goes back
+// to the client as an ORCA report in the trailing metadata.
+void StorageServiceImpl::RecordLoad(CallbackServerContext* context) {
+  if (!options_.orca) {
+    return;
+  }
+  auto* recorder = context->ExperimentalGetCallMetricRecorder();
+  if (recorder == nullptr) {
+    return;
+  }
+  const double qps = qps_meter_->Record();
+  recorder->RecordQpsMetric(qps);
+  recorder->RecordCpuUtilizationMetric(
+      options_.orca_capacity_qps > 0 ? qps / options_.orca_capacity_qps
+                                     : options_.orca_cpu_utilization);
+}
+
+ServerUnaryReactor* StorageServiceImpl::GetObject(
+    CallbackServerContext* context, const GetObjectRequest* request,
+    Object* reply) {
+  RecordLoad(context);
+  Status status;
+  const int64_t object_size =
+      GcsUtil::GetObjectSize(request->bucket(), request->object());
+  if (object_size < 0) {
+    status = Status(StatusCode::NOT_FOUND, "Object is not found");
+  } else {
+    status = Status::OK;
+    reply->set_size(object_size);
+  }
+  ServerUnaryReactor* reactor = context->DefaultReactor();
+  reactor->Finish(status);
+  return reactor;
+}
+
+grpc::ServerWriteReactor<ReadObjectResponse>* StorageServiceImpl::ReadObject(
+    CallbackServerContext* context, const ReadObjectRequest* request) {
+  RecordLoad(context);
+  class Reactor : public grpc::ServerWriteReactor<ReadObjectResponse> {
+   public:
+    Reactor(const ReadObjectRequest* request, absl::Duration read_delay)
+        : read_delay_(read_delay) {
+      const int64_t object_size =
+          GcsUtil::GetObjectSize(request->bucket(), request->object());
+      if (object_size < 0) {
+        Finish(Status(StatusCode::NOT_FOUND, "Object is not found"));
+        return;
+      }
+      left_size_ = object_size;
+      if (request->read_limit() > 0) {
+        left_size_ = std::min(left_size_, request->read_limit());
+      }
+      chunk_data_ = absl::Cord(GcsUtil::GetObjectDataChunk(
+          google::storage::v2::ServiceConstants::MAX_READ_CHUNK_BYTES));
+      MaybeWriteNext();
+    }
+
+    void OnWriteDone(bool ok) override {
+      if (ok) {
+        MaybeWriteNext();
+      } else {
+        Finish(grpc::Status(grpc::StatusCode::UNKNOWN, "Unexpected failure"));
+      }
+    }
+
+    void OnDone() override { delete this; }
+
+   private:
+    void MaybeWriteNext() {
+      if (left_size_ == 0) {
+        Finish(grpc::Status::OK);
+        return;
+      }
+      auto data_size =
+          std::min(left_size_, static_cast<int64_t>(chunk_data_.size()));
+      response_.mutable_checksummed_data()->set_content(
+          chunk_data_.Subcord(0, data_size));
+      left_size_ -= data_size;
+      if (read_delay_ > absl::ZeroDuration()) {
+        alarm_.Set(absl::ToChronoTime(absl::Now() + read_delay_),
+                   [this](bool) { StartWrite(&response_); });
+        return;
+      }
+      StartWrite(&response_);
+    }
+
+   private:
+    absl::Duration read_delay_;
+    grpc::Alarm alarm_;
+    int64_t left_size_;
+    absl::Cord chunk_data_;
+    ReadObjectResponse response_;
+  };
+
+  absl::Duration read_delay = absl::ZeroDuration();
+  if (options_.read_delay > absl::ZeroDuration() &&
+      IsSlowPeer(context->peer())) {
+    read_delay = options_.read_delay;
+  }
+  return new Reactor(request, read_delay);
+}
+
+grpc::ServerReadReactor<WriteObjectRequest>* StorageServiceImpl::WriteObject(
+    CallbackServerContext* context, WriteObjectResponse* response) {
+  RecordLoad(context);
+  class Reactor : public grpc::ServerReadReactor<WriteObjectRequest> {
+   public:
+    explicit Reactor(WriteObjectResponse* response) { StartRead(&request_); }
+
+    void OnReadDone(bool ok) override {
+      if (!ok) {
+        Finish(grpc::Status::OK);
+        return;
+      }
+      StartRead(&request_);
+    }
+
+    void OnDone() override { delete this; }
+
+   private:
+    WriteObjectRequest request_;
+    WriteObjectResponse* response_ = nullptr;
+  };
+  return new Reactor(response);
+}
@@ -0,0 +1,69 @@
+// Copyright 2026 gRPC authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef GCS_BENCHMARK_DUMMY_SERVER_STORAGE_SERVICE_H_
+#define GCS_BENCHMARK_DUMMY_SERVER_STORAGE_SERVICE_H_
+
+#include <memory>
+
+#include "absl/time/time.h"
+#include "google/storage/v2/storage.grpc.pb.h"
+
+struct StorageServiceOptions {
+  // Delay before sending each chunk of ReadObject to slow peers
+  absl::Duration read_delay = absl::ZeroDuration();
+  // Ratio of peers (client connections) which get read_delay
+  double slow_peer_ratio = 1.0;
+  // Attach ORCA load reports to responses
+  bool orca = false;
+  // CPU utilization to report when orca_capacity_qps is not set
+  double orca_cpu_utilization = 0.5;
+  // QPS at which the server reports full CPU utilization
+  double orca_capacity_qps = 0;
+};
+
+class QpsMeter;
+
+// Storage service serving objects whose size comes from their names.
+// It is used by the dummy server and by benchmarks running the server in
+// their own process.
+class StorageServiceImpl final
+    : public google::storage::v2::Storage::CallbackService {
+ public:
+  explicit StorageServiceImpl(StorageServiceOptions options = {});
+  ~StorageServiceImpl() override;
+
+  grpc::ServerUnaryReactor* GetObject(
+      grpc::CallbackServerContext* context,
+      const google::storage::v2::GetObjectRequest* request,
+      google::storage::v2::Object* reply) override;
+
+  grpc::ServerWriteReactor<google::storage::v2::ReadObjectResponse>*
+  ReadObject(grpc::CallbackServerContext* context,
+             const google::storage::v2::ReadObjectRequest* request) override;
+
+  grpc::ServerReadReactor<google::storage::v2::WriteObjectRequest>*
+  WriteObject(grpc::CallbackServerContext* context,
+              google::storage::v2::WriteObjectResponse* response) override;
+
+ private:
+  bool IsSlowPeer(const std::string& peer) const;
+  void RecordLoad(grpc::CallbackServerContext* context);
+
+ private:
+  StorageServiceOptions options_;
+  std::unique_ptr<QpsMeter> qps_meter_;
+};
+
+#endif  // GCS_BENCHMARK_DUMMY_SERVER_STORAGE_SERVICE_H_
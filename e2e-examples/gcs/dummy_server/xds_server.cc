@@ -0,0 +1,337 @@
+// Copyright 2026 gRPC authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xds_server.h"
+
+#include <grpcpp/generic/async_generic_service.h>
+#include <grpcpp/security/server_credentials.h>
+#include <grpcpp/server_builder.h>
+#include <grpcpp/support/byte_buffer.h>
+
+#include <atomic>
+#include <deque>
+#include <map>
+#include <set>
+
+#include "absl/strings/str_cat.h"
+#include "envoy/config/cluster/v3/cluster.pb.h"
+#include "envoy/config/endpoint/v3/endpoint.pb.h"
+#include "envoy/config/listener/v3/listener.pb.h"
+#include "envoy/extensions/filters/http/router/v3/router.pb.h"
+#include "envoy/extensions/filters/network/http_connection_manager/v3/http_connection_manager.pb.h"
+#include "envoy/service/discovery/v3/discovery.pb.h"
+
+using envoy::service::discovery::v3::DiscoveryRequest;
+using envoy::service::discovery::v3::DiscoveryResponse;
+
+namespace {
+
+constexpr char kAdsMethod[] =
+    "/envoy.service.discovery.v3.AggregatedDiscoveryService/"
+    "StreamAggregatedResources";
+constexpr char kListenerType[] =
+    "type.googleapis.com/envoy.config.listener.v3.Listener";
+constexpr char kClusterType[] =
+    "type.googleapis.com/envoy.config.cluster.v3.Cluster";
+constexpr char kEndpointType[] =
+    "type.googleapis.com/envoy.config.endpoint.v3.ClusterLoadAssignment";
+constexpr char kClusterName[] = "dummy-cluster";
+
+std::string ToString(const grpc::ByteBuffer& buffer) {
+  std::vector<grpc::Slice> slices;
+  std::string s;
+  if (buffer.Dump(&slices).ok()) {
+    for (const auto& slice : slices) {
+      s.append(reinterpret_cast<const char*>(slice.begin()), slice.size());
+    }
+  }
+  return s;
+}
+
+grpc::ByteBuffer ToByteBuffer(const std::string& s) {
+  grpc::Slice slice(s);
+  return grpc::ByteBuffer(&slice, 1);
+}
+
+envoy::config::listener::v3::Listener BuildListener(const std::string& name) {
+  // Every request goes to the one cluster through the router filter.
+  envoy::extensions::filters::network::http_connection_manager::v3::
+      HttpConnectionManager manager;
+  auto* route_config = manager.mutable_route_config();
+  route_config->set_name("dummy-route");
+  auto* virtual_host = route_config->add_virtual_hosts();
+  virtual_host->set_name("dummy-host");
+  virtual_host->add_domains("*");
+  auto* route = virtual_host->add_routes();
+  route->mutable_match()->set_prefix("");
+  route->mutable_route()->set_cluster(kClusterName);
+  auto* filter = manager.add_http_filters();
+  filter->set_name("router");
+  filter->mutable_typed_config()->PackFrom(
+      envoy::extensions::filters::http::router::v3::Router());
+
+  envoy::config::listener::v3::Listener listener;
+  listener.set_name(name);
+  listener.mutable_api_listener()->mutable_api_listener()->PackFrom(manager);
+  return listener;
+}
+
+envoy::config::cluster::v3::Cluster BuildCluster(const std::string& name) {
+  envoy::config::cluster::v3::Cluster cluster;
+  cluster.set_name(name);
+  cluster.set_type(envoy::config::cluster::v3::Cluster::EDS);
+  cluster.mutable_eds_cluster_config()->mutable_eds_config()->mutable_ads();
+  cluster.set_lb_policy(envoy::config::cluster::v3::Cluster::ROUND_ROBIN);
+  return cluster;
+}
+
+// Each version rotates the locality weights and the order of backends over
+// localities so that clients get a changed resource on every update rather
+// than the same one they drop as unchanged.
+envoy::config::endpoint::v3::ClusterLoadAssignment BuildLoadAssignment(
+    const std::string& name, const XdsServerOptions& options,
+    int64_t version) {
+  envoy::config::endpoint::v3::ClusterLoadAssignment assignment;
+  assignment.set_cluster_name(name);
+  const size_t localities = options.locality_weights.size();
+  const size_t backends = options.backend_ips.size();
+  for (size_t i = 0; i < localities; i++) {
+    auto* endpoints = assignment.add_endpoints();
+    endpoints->mutable_locality()->set_region("dummy");
+    endpoints->mutable_locality()->set_zone(absl::StrCat("zone-", i));
+    endpoints->mutable_load_balancing_weight()->set_value(
+        options.locality_weights[(i + version) % localities]);
+  }
+  for (size_t i = 0; i < backends; i++) {
+    auto* endpoint =
+        assignment.mutable_endpoints(i % localities)->add_lb_endpoints();
+    auto* address = endpoint->mutable_endpoint()
+                        ->mutable_address()
+                        ->mutable_socket_address();
+    address->set_address(options.backend_ips[(i + version) % backends]);
+    address->set_port_value(options.backend_port);
+  }
+  return assignment;
+}
+
+}  // namespace
+
+// Handles ADS streams in the state-of-the-world protocol. Each stream gets
+// the resources of a type whenever the names it subscribes to change and
+// every stream gets new endpoints when they are updated.
+class XdsService : public grpc::CallbackGenericService {
+ public:
+  explicit XdsService(XdsServerOptions options)
+      : options_(std::move(options)) {}
+
+  grpc::ServerGenericBidiReactor* CreateReactor(
+      grpc::GenericCallbackServerContext* context) override;
+
+  // Sends a new version of endpoints to every stream.
+  void UpdateEndpoints();
+
+ private:
+  class Stream;
+
+  DiscoveryResponse BuildResponse(const std::string& type_url,
+                                  const std::vector<std::string>& names);
+  void Remove(Stream* stream);
+
+ private:
+  XdsServerOptions options_;
+  std::atomic<int64_t> version_{1};
+  std::atomic<int64_t> nonce_{1};
+  absl::Mutex mu_;
+  std::set<Stream*> streams_ ABSL_GUARDED_BY(mu_);
+};
+
+class XdsService::Stream : public grpc::ServerGenericBidiReactor {
+ public:
+  explicit Stream(XdsService* service) : service_(service) {
+    StartRead(&request_buffer_);
+  }
+
+  void OnReadDone(bool ok) override {
+    if (!ok) {
+      // Finishes once the pending responses are written.
+      absl::MutexLock l(&mu_);
+      finished_ = true;
+      if (writes_.empty()) {
+        Finish(grpc::Status::OK);
+      }
+      return;
+    }
+    DiscoveryRequest request;
+    if (request.ParseFromString(ToString(request_buffer_))) {
+      HandleRequest(request);
+    }
+    StartRead(&request_buffer_);
+  }
+
+  void OnWriteDone(bool ok) override {
+    absl::MutexLock l(&mu_);
+    writes_.pop_front();
+    if (!ok) {
+      writes_.clear();
+    } else if (!writes_.empty()) {
+      StartWrite(&writes_.front());
+      return;
+    }
+    if (finished_) {
+      Finish(grpc::Status::OK);
+    }
+  }
+
+  void OnDone() override {
+    service_->Remove(this);
+    delete this;
+  }
+
+  // Sends the latest resources of the type if the stream subscribes to it.
+  void Push(const std::string& type_url) {
+    std::vector<std::string> names;
+    {
+      absl::MutexLock l(&mu_);
+      auto it = subscriptions_.find(type_url);
+      if (it == subscriptions_.end()) {
+        return;
+      }
+      names = it->second;
+    }
+    Send(service_->BuildResponse(type_url, names));
+  }
+
+ private:
+  void HandleRequest(const DiscoveryRequest& request) {
+    std::vector<std::string> names(request.resource_names().begin(),
+                                   request.resource_names().end());
+    {
+      absl::MutexLock l(&mu_);
+      // ACKs and NACKs come with the names the stream already has.
+      auto it = subscriptions_.find(request.type_url());
+      if (it != subscriptions_.end() && it->second == names &&
+          !request.response_nonce().empty()) {
+        return;
+      }
+      subscriptions_[request.type_url()] = names;
+    }
+    Send(service_->BuildResponse(request.type_url(), names));
+  }
+
+  void Send(const DiscoveryResponse& response) {
+    absl::MutexLock l(&mu_);
+    if (finished_) {
+      return;
+    }
+    writes_.push_back(ToByteBuffer(response.SerializeAsString()));
+    if (writes_.size() == 1) {
+      StartWrite(&writes_.front());
+    }
+  }
+
+ private:
+  XdsService* service_;
+  grpc::ByteBuffer request_buffer_;
+  absl::Mutex mu_;
+  bool finished_ ABSL_GUARDED_BY(mu_) = false;
+  std::map<std::string, std::vector<std::string>> subscriptions_
+      ABSL_GUARDED_BY(mu_);
+  // Responses being written. Only the front one is in flight.
+  std::deque<grpc::ByteBuffer> writes_ ABSL_GUARDED_BY(mu_);
+};
+
+grpc::ServerGenericBidiReactor* XdsService::CreateReactor(
+    grpc::GenericCallbackServerContext* context) {
+  if (context->method() != kAdsMethod) {
+    return grpc::CallbackGenericService::CreateReactor(context);
+  }
+  auto* stream = new Stream(this);
+  absl::MutexLock l(&mu_);
+  streams_.insert(stream);
+  return stream;
+}
+
+void XdsService::UpdateEndpoints() {
+  version_++;
+  absl::MutexLock l(&mu_);
+  for (Stream* stream : streams_) {
+    stream->Push(kEndpointType);
+  }
+}
+
+DiscoveryResponse XdsService::BuildResponse(
+    const std::string& type_url, const std::vector<std::string>& names) {
+  const int64_t version = version_.load();
+  DiscoveryResponse response;
+  response.set_version_info(absl::StrCat(version));
+  response.set_type_url(type_url);
+  response.set_nonce(absl::StrCat(nonce_++));
+  for (const auto& name : names) {
+    if (type_url == kListenerType) {
+      response.add_resources()->PackFrom(BuildListener(name));
+    } else if (type_url == kClusterType) {
+      response.add_resources()->PackFrom(BuildCluster(name));
+    } else if (type_url == kEndpointType) {
+      response.add_resources()->PackFrom(
+          BuildLoadAssignment(name, options_, version));
+    }
+  }
+  return response;
+}
+
+void XdsService::Remove(Stream* stream) {
+  absl::MutexLock l(&mu_);
+  streams_.erase(stream);
+}
+
+std::unique_ptr<XdsServer> XdsServer::Start(int port,
+                                            XdsServerOptions options) {
+  std::unique_ptr<XdsServer> server(new XdsServer());
+  const absl::Duration update_interval = options.update_interval;
+  server->service_.reset(new XdsService(std::move(options)));
+  grpc::ServerBuilder builder;
+  builder.AddListeningPort(absl::StrCat("127.0.0.1:", port),
+                           grpc::InsecureServerCredentials());
+  builder.RegisterCallbackGenericService(server->service_.get());
+  server->server_ = builder.BuildAndStart();
+  if (server->server_ == nullptr) {
+    return nullptr;
+  }
+  if (update_interval > absl::ZeroDuration()) {
+    XdsServer* s = server.get();
+    server->update_thread_ = std::unique_ptr<std::thread>(new std::thread(
+        [s, update_interval]() { s->UpdateLoop(update_interval); }));
+  }
+  return server;
+}
+
+XdsServer::~XdsServer() {
+  if (update_thread_ != nullptr) {
+    {
+      absl::MutexLock l(&mu_);
+      shutdown_ = true;
+    }
+    update_thread_->join();
+  }
+  if (server_ != nullptr) {
+    server_->Shutdown();
+  }
+}
+
+void XdsServer::UpdateLoop(absl::Duration interval) {
+  absl::MutexLock l(&mu_);
+  while (!mu_.AwaitWithTimeout(absl::Condition(&shutdown_), interval)) {
+    service_->UpdateEndpoints();
+  }
+}
@@ -0,0 +1,64 @@
+// Copyright 2026 gRPC authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef GCS_BENCHMARK_DUMMY_SERVER_XDS_SERVER_H_
+#define GCS_BENCHMARK_DUMMY_SERVER_XDS_SERVER_H_
+
+#include <grpcpp/server.h>
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+
+struct XdsServerOptions {
+  // IPv4 addresses of backends which all listen on backend_port
+  std::vector<std::string> backend_ips;
+  int backend_port = 0;
+  // Weights of localities. Backends are spread over localities in turn.
+  std::vector<int> locality_weights = {1};
+  // Interval to push a new version of endpoints (0 for never). Versions
+  // rotate the locality weights and the backends over localities, which
+  // changes nothing with a single backend in a single locality.
+  absl::Duration update_interval = absl::ZeroDuration();
+};
+
+class XdsService;
+
+// Local stand-in for the xDS control plane. It serves ADS streams with a
+// listener of any requested name routing to one EDS cluster whose endpoints
+// are the backends grouped into weighted localities.
+class XdsServer {
+ public:
+  // Returns nullptr if it cannot listen on the port of localhost.
+  static std::unique_ptr<XdsServer> Start(int port, XdsServerOptions options);
+
+  ~XdsServer();
+
+ private:
+  XdsServer() = default;
+  void UpdateLoop(absl::Duration interval);
+
+ private:
+  std::unique_ptr<XdsService> service_;
+  std::unique_ptr<grpc::Server> server_;
+  std::unique_ptr<std::thread> update_thread_;
+  absl::Mutex mu_;
+  bool shutdown_ ABSL_GUARDED_BY(mu_) = false;
+};
+
+#endif  // GCS_BENCHMARK_DUMMY_SERVER_XDS_SERVER_H_